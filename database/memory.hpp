@@ -0,0 +1,142 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <properties.hpp>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "database.hpp"
+
+namespace tb::database {
+
+// in process ordered key value store shared by all connections.
+// it serves typed operations natively and measures the client side overhead
+// of a workload without any server or SQL text.
+class MemoryDatabase : public Database {
+ private:
+  using Table = std::map<std::string, std::string, std::less<>>;
+
+  struct Store {
+    std::shared_mutex mutex;
+    std::map<std::string, Table, std::less<>> tables;
+  };
+
+ private:
+  Store& store_;
+  std::string scan_buffer_;
+
+ public:
+  MemoryDatabase() : store_(SharedStore()) {}
+
+ public:
+  // only transaction control is accepted as text
+  void execute(std::string_view query) override {
+    if (query == "BEGIN" || query == "COMMIT" || query == "ROLLBACK") {
+      return;
+    }
+    throw DatabaseError("memory database accepts only key value operations",
+                        ErrorClass::kOther, "");
+  }
+
+  // operations are applied immediately, transactions are not isolated
+  void begin(const TransactionOptions&) override {}
+  void commit() override {}
+  void rollback() override {}
+  void savepoint(std::string_view) override {}
+  void releaseSavepoint(std::string_view) override {}
+  void rollbackToSavepoint(std::string_view) override {}
+
+  void operate(const Operation& operation) override {
+    switch (operation.type) {
+      case Operation::Type::kRead: {
+        std::shared_lock lock(store_.mutex);
+        const auto table = find(operation.table);
+        if (table != nullptr) {
+          const auto it = table->find(operation.key);
+          if (it != std::end(*table)) {
+            scan_buffer_.assign(it->second);
+          }
+        }
+        break;
+      }
+      case Operation::Type::kScan: {
+        std::shared_lock lock(store_.mutex);
+        const auto table = find(operation.table);
+        if (table == nullptr) {
+          break;
+        }
+        auto it = table->lower_bound(operation.key);
+        for (std::size_t i = 0; i < operation.length && it != std::end(*table);
+             ++i, ++it) {
+          scan_buffer_.assign(it->second);
+        }
+        break;
+      }
+      case Operation::Type::kInsert: {
+        std::lock_guard lock(store_.mutex);
+        auto& table = store_.tables[std::string(operation.table)];
+        const auto [it, inserted] = table.try_emplace(
+            std::string(operation.key), std::string(operation.value));
+        static_cast<void>(it);
+        if (!inserted) {
+          throw DatabaseError("duplicate key", ErrorClass::kConstraint, "");
+        }
+        break;
+      }
+      case Operation::Type::kUpdate: {
+        std::lock_guard lock(store_.mutex);
+        const auto table = find(operation.table);
+        if (table != nullptr) {
+          const auto it = table->find(operation.key);
+          if (it != std::end(*table)) {
+            it->second.assign(operation.value);
+          }
+        }
+        break;
+      }
+      case Operation::Type::kDelete: {
+        std::lock_guard lock(store_.mutex);
+        const auto table = find(operation.table);
+        if (table != nullptr) {
+          const auto it = table->find(operation.key);
+          if (it != std::end(*table)) {
+            table->erase(it);
+          }
+        }
+        break;
+      }
+    }
+  }
+
+ public:
+  // size of the store, shared by every connection
+  std::vector<ServerMetric> serverMetrics() override {
+    std::shared_lock lock(store_.mutex);
+    std::size_t keys = 0;
+    for (const auto& [name, table] : store_.tables) {
+      keys += std::size(table);
+    }
+    return {{"tables", static_cast<double>(std::size(store_.tables)), false},
+            {"keys", static_cast<double>(keys), false}};
+  }
+
+  static std::unique_ptr<Database> Make(const Properties&) {
+    return std::make_unique<MemoryDatabase>();
+  }
+
+ private:
+  Table* find(std::string_view name) {
+    const auto it = store_.tables.find(name);
+    return it == std::end(store_.tables) ? nullptr : &it->second;
+  }
+
+  static Store& SharedStore() {
+    static Store store;
+    return store;
+  }
+};
+
+}  // namespace tb::database
@@ -6,11 +6,13 @@
 
 #include <mysql/mysql.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
-#include <mutex>
 #include <properties.hpp>
-#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "database.hpp"
 
@@ -26,14 +28,14 @@ class MySQL : public Database {
         const std::string& database, const std::string& user,
         const std::string& password)
       : connection_(std::make_unique<MYSQL>()) {
-    static std::mutex mtx;
-    {
-      std::lock_guard lg(mtx);
-      mysql_init(connection_.get());
-    }
-
     using namespace std::string_literals;
 
+    InitializeLibrary();
+    if (mysql_init(connection_.get()) == nullptr) {
+      connection_.reset();
+      throw std::runtime_error("MySQL connection cannot be initialized");
+    }
+
     const auto con = mysql_real_connect(connection_.get(), host.c_str(),
                                         user.c_str(), password.c_str(),
                                         database.c_str(), port, nullptr, 0);
@@ -69,6 +71,40 @@ class MySQL : public Database {
     return std::make_unique<MySQL>(props);
   }
 
+ private:
+  // mysql_init is thread safe once the library was initialized,
+  // function local statics are initialized exactly once
+  static void InitializeLibrary() {
+    static const bool initialized =
+        mysql_library_init(0, nullptr, nullptr) == 0;
+    if (!initialized) {
+      throw std::runtime_error("MySQL library cannot be initialized");
+    }
+  }
+
+  static ErrorClass Classify(unsigned int code) {
+    switch (code) {
+      case 1213:  // ER_LOCK_DEADLOCK
+        return ErrorClass::kDeadlock;
+      case 1205:  // ER_LOCK_WAIT_TIMEOUT
+      case 3024:  // ER_QUERY_TIMEOUT
+        return ErrorClass::kTimeout;
+      case 1062:  // ER_DUP_ENTRY
+      case 1451:  // ER_ROW_IS_REFERENCED_2
+      case 1452:  // ER_NO_REFERENCED_ROW_2
+        return ErrorClass::kConstraint;
+      case 3101:  // ER_TRANSACTION_ROLLBACK_DURING_COMMIT
+        return ErrorClass::kSerialization;
+      case 2002:  // CR_CONNECTION_ERROR
+      case 2003:  // CR_CONN_HOST_ERROR
+      case 2006:  // CR_SERVER_GONE_ERROR
+      case 2013:  // CR_SERVER_LOST
+        return ErrorClass::kConnection;
+      default:
+        return ErrorClass::kOther;
+    }
+  }
+
  public:
   void execute(std::string_view query) override {
     using namespace std::string_literals;
@@ -77,8 +113,97 @@ class MySQL : public Database {
       const auto message =
           "query execute failed: "s + mysql_error(connection_.get());
       std::cout << message << std::endl;
-      throw std::runtime_error(message);
+      const auto code = mysql_errno(connection_.get());
+      throw DatabaseError(message, Classify(code), std::to_string(code));
+    }
+
+    // results must be consumed before the next query can be sent
+    if (auto result = mysql_store_result(connection_.get())) {
+      mysql_free_result(result);
+    }
+  }
+
+  std::vector<Row> query(std::string_view query) override {
+    using namespace std::string_literals;
+
+    if (mysql_real_query(connection_.get(), query.data(), query.size()) != 0) {
+      const auto code = mysql_errno(connection_.get());
+      throw DatabaseError(
+          "query execute failed: "s + mysql_error(connection_.get()),
+          Classify(code), std::to_string(code));
+    }
+
+    std::vector<Row> rows;
+    auto result = mysql_store_result(connection_.get());
+    if (result == nullptr) {
+      return rows;
+    }
+    const auto columns = mysql_num_fields(result);
+    const auto fields = mysql_fetch_fields(result);
+    while (auto row = mysql_fetch_row(result)) {
+      const auto lengths = mysql_fetch_lengths(result);
+      auto& values = rows.emplace_back();
+      for (unsigned int c = 0; c < columns; ++c) {
+        values.emplace_back(fields[c].name,
+                            row[c] ? std::string(row[c], lengths[c]) : "");
+      }
+    }
+    mysql_free_result(result);
+    return rows;
+  }
+
+  // commits, buffer pool hits, redo and row lock waits of InnoDB
+  std::vector<ServerMetric> serverMetrics() override {
+    constexpr std::string_view kGauges[] = {
+        "Innodb_buffer_pool_pages_dirty", "Innodb_row_lock_current_waits",
+        "Threads_connected", "Threads_running"};
+
+    std::vector<ServerMetric> metrics;
+    for (const auto& row : query(
+             "SHOW GLOBAL STATUS WHERE Variable_name IN ('Com_commit', "
+             "'Com_rollback', 'Questions', 'Innodb_buffer_pool_read_requests', "
+             "'Innodb_buffer_pool_reads', 'Innodb_buffer_pool_pages_flushed', "
+             "'Innodb_buffer_pool_pages_dirty', 'Innodb_data_fsyncs', "
+             "'Innodb_log_waits', 'Innodb_os_log_written', "
+             "'Innodb_row_lock_waits', 'Innodb_row_lock_time', "
+             "'Innodb_row_lock_current_waits', 'Innodb_rows_read', "
+             "'Innodb_rows_inserted', 'Innodb_rows_updated', "
+             "'Innodb_rows_deleted', 'Threads_connected', "
+             "'Threads_running')")) {
+      if (std::size(row) < 2) {
+        continue;
+      }
+      const auto& name = row[0].second;
+      const auto counter = std::find(std::begin(kGauges), std::end(kGauges),
+                                     name) == std::end(kGauges);
+      metrics.push_back(
+          {name, std::strtod(row[1].second.c_str(), nullptr), counter});
+    }
+    return metrics;
+  }
+
+  // the isolation level is set for the next transaction only,
+  // START TRANSACTION does not take it
+  void begin(const TransactionOptions& options) override {
+    if (options.isolation) {
+      execute(SetIsolationQuery(*options.isolation));
+    }
+    execute(options.read_only ? "START TRANSACTION READ ONLY" : "BEGIN");
+  }
+
+ private:
+  static const char* SetIsolationQuery(Isolation isolation) {
+    switch (isolation) {
+      case Isolation::kReadUncommitted:
+        return "SET TRANSACTION ISOLATION LEVEL READ UNCOMMITTED";
+      case Isolation::kReadCommitted:
+        return "SET TRANSACTION ISOLATION LEVEL READ COMMITTED";
+      case Isolation::kRepeatableRead:
+        return "SET TRANSACTION ISOLATION LEVEL REPEATABLE READ";
+      case Isolation::kSerializable:
+        break;
     }
+    return "SET TRANSACTION ISOLATION LEVEL SERIALIZABLE";
   }
 };
 
@@ -6,9 +6,12 @@
 
 #include <postgresql/libpq-fe.h>
 
+#include <cstdlib>
 #include <database.hpp>
 #include <memory>
 #include <properties.hpp>
+#include <string>
+#include <vector>
 
 namespace tb::database {
 
@@ -16,6 +19,10 @@ class PostgreSQL : public Database {
  private:
   PGconn* connection_ = nullptr;
   PGresult* result_ = nullptr;
+  // PQexec needs a null terminated query, kept to reuse its capacity
+  std::string query_buffer_;
+  // text parameters of an operation, null terminated as well
+  std::string key_buffer_, value_buffer_;
 
  public:
   PostgreSQL() = default;
@@ -28,6 +35,7 @@ class PostgreSQL : public Database {
     if (PQstatus(connection_) == CONNECTION_BAD) {
       std::string message = "connection cannot be established. ";
       message += PQerrorMessage(connection_);
+      close();
       throw std::runtime_error(message);
     }
   }
@@ -62,12 +70,131 @@ class PostgreSQL : public Database {
     return std::make_unique<PostgreSQL>(props);
   }
 
+ private:
+  static ErrorClass Classify(const std::string& sqlstate) {
+    if (sqlstate == "40001") {
+      return ErrorClass::kSerialization;
+    }
+    if (sqlstate == "40P01") {
+      return ErrorClass::kDeadlock;
+    }
+    if (sqlstate == "57014" || sqlstate == "55P03") {
+      return ErrorClass::kTimeout;
+    }
+    const auto sqlclass = sqlstate.substr(0, 2);
+    if (sqlclass == "23") {
+      return ErrorClass::kConstraint;
+    }
+    if (sqlclass == "08" || sqlstate.empty()) {
+      return ErrorClass::kConnection;
+    }
+    return ErrorClass::kOther;
+  }
+
  public:
   void execute(std::string_view query) override {
-    result_ = PQexec(connection_, std::string(query).c_str());
-    if (PQresultStatus(result_) != PGRES_COMMAND_OK) {
+    if (result_) {
+      PQclear(result_);
+    }
+    query_buffer_.assign(query);
+    result_ = PQexec(connection_, query_buffer_.c_str());
+    check();
+  }
+
+  // key and value are bound as text parameters, X'..' literals of the
+  // generic SQL would be bit strings here
+  void operate(const Operation& operation) override {
+    if (result_) {
+      PQclear(result_);
+    }
+    query_buffer_.clear();
+    AppendSql(query_buffer_, operation,
+              [](std::string& out, std::string_view, int parameter) {
+                out += parameter == 1 ? "$1" : "$2";
+              });
+    key_buffer_.assign(operation.key);
+    value_buffer_.assign(operation.value);
+    const char* values[] = {key_buffer_.c_str(), value_buffer_.c_str()};
+    const auto with_value = operation.type == Operation::Type::kInsert ||
+                            operation.type == Operation::Type::kUpdate;
+    result_ = PQexecParams(connection_, query_buffer_.c_str(),
+                           with_value ? 2 : 1, nullptr, values, nullptr,
+                           nullptr, 0);
+    check();
+  }
+
+  std::vector<Row> query(std::string_view query) override {
+    if (result_) {
+      PQclear(result_);
+    }
+    query_buffer_.assign(query);
+    result_ = PQexec(connection_, query_buffer_.c_str());
+    if (PQresultStatus(result_) != PGRES_TUPLES_OK) {
+      const auto sqlstate = PQresultErrorField(result_, PG_DIAG_SQLSTATE);
+      const std::string code = sqlstate ? sqlstate : "";
+      throw DatabaseError(PQresultErrorMessage(result_), Classify(code), code);
+    }
+
+    std::vector<Row> rows(static_cast<std::size_t>(PQntuples(result_)));
+    const auto columns = PQnfields(result_);
+    for (std::size_t r = 0; r < std::size(rows); ++r) {
+      for (int c = 0; c < columns; ++c) {
+        rows[r].emplace_back(
+            PQfname(result_, c),
+            PQgetvalue(result_, static_cast<int>(r), c));
+      }
+    }
+    return rows;
+  }
+
+  // activity of the current database, the background writer and
+  // checkpoints, and sessions waiting for locks
+  std::vector<ServerMetric> serverMetrics() override {
+    std::vector<ServerMetric> metrics;
+    Numeric("database.",
+            query("SELECT xact_commit, xact_rollback, blks_read, blks_hit, "
+                  "tup_returned, tup_fetched, tup_inserted, tup_updated, "
+                  "tup_deleted, conflicts, deadlocks, temp_files, temp_bytes "
+                  "FROM pg_stat_database WHERE datname = current_database()"),
+            true, metrics);
+    Numeric("bgwriter.", query("SELECT * FROM pg_stat_bgwriter"), true,
+            metrics);
+    // checkpoints moved out of pg_stat_bgwriter in 17
+    if (PQserverVersion(connection_) >= 170000) {
+      Numeric("checkpointer.", query("SELECT * FROM pg_stat_checkpointer"),
+              true, metrics);
+    }
+    Numeric("",
+            query("SELECT count(*) FILTER (WHERE NOT granted) AS lock_waits, "
+                  "(SELECT count(*) FROM pg_stat_activity WHERE state = "
+                  "'active') AS active_sessions FROM pg_locks"),
+            false, metrics);
+    return metrics;
+  }
+
+ private:
+  void check() {
+    const auto status = PQresultStatus(result_);
+    if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
       std::cout << "exec error: " << PQresultErrorMessage(result_) << std::endl;
-      throw std::runtime_error("exec error");
+      const auto sqlstate = PQresultErrorField(result_, PG_DIAG_SQLSTATE);
+      const std::string code = sqlstate ? sqlstate : "";
+      throw DatabaseError("exec error", Classify(code), code);
+    }
+  }
+
+  // numeric columns of the first row, others like timestamps are skipped
+  static void Numeric(const std::string& prefix, const std::vector<Row>& rows,
+                      bool counter, std::vector<ServerMetric>& metrics) {
+    if (std::empty(rows)) {
+      return;
+    }
+    for (const auto& [column, text] : rows.front()) {
+      char* end = nullptr;
+      const auto value = std::strtod(text.c_str(), &end);
+      if (!std::empty(text) && *end == '\0') {
+        metrics.push_back({prefix + column, value, counter});
+      }
     }
   }
 };
@@ -6,25 +6,542 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <chrono>
 #include <fstream>
+#include <optional>
+#include <random>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "../src/clock.hpp"
+#include "../src/data_file.hpp"
 #include "../src/template_engine.hpp"
+#include "database.hpp"
+#include "think_time.hpp"
 
 namespace tb {
 
+struct SweepSetting {
+  std::size_t min_threads = 1, max_threads = 256;
+  // thread count is multiplied by factor when step is 0
+  double factor = 2.0;
+  std::size_t step = 0;
+  // stop when throughput falls below (1 - drop_tolerance) of the peak
+  double drop_tolerance = 0.05;
+
+  static SweepSetting Make(const YAML::Node& node) {
+    SweepSetting setting;
+    if (node["min"]) {
+      setting.min_threads = node["min"].as<std::size_t>();
+    }
+    if (node["max"]) {
+      setting.max_threads = node["max"].as<std::size_t>();
+    }
+    if (node["factor"]) {
+      setting.factor = node["factor"].as<double>();
+    }
+    if (node["step"]) {
+      setting.step = node["step"].as<std::size_t>();
+    }
+    if (node["drop_tolerance"]) {
+      setting.drop_tolerance = node["drop_tolerance"].as<double>();
+    }
+    setting.validate();
+    return setting;
+  }
+
+  // "min-max" form used by the command line
+  static SweepSetting Parse(const std::string& range) {
+    SweepSetting setting;
+    const auto pos = range.find('-');
+    try {
+      if (pos == std::string::npos) {
+        setting.max_threads = std::stoul(range);
+      } else {
+        setting.min_threads = std::stoul(range.substr(0, pos));
+        setting.max_threads = std::stoul(range.substr(pos + 1));
+      }
+    } catch (const std::exception&) {
+      throw std::runtime_error("invalid sweep range " + range);
+    }
+    setting.validate();
+    return setting;
+  }
+
+  [[nodiscard]] std::size_t next(std::size_t threads) const {
+    if (step > 0) {
+      return threads + step;
+    }
+    const auto next = static_cast<std::size_t>(
+        static_cast<double>(threads) * factor);
+    return std::max(next, threads + 1);
+  }
+
+ private:
+  void validate() const {
+    if (min_threads == 0 || min_threads > max_threads) {
+      throw std::runtime_error("invalid sweep thread range");
+    }
+    if (step == 0 && factor <= 1.0) {
+      throw std::runtime_error("sweep factor must be greater than 1");
+    }
+  }
+};
+
+struct SloSetting {
+  double percentile = 99.0;
+  std::chrono::microseconds latency{0};
+  double max_error_rate = 0.01;
+  // offered load range in transactions per second, max 0 probes upward
+  double min_rate = 100.0, max_rate = 0.0;
+  // length of a measurement window
+  std::chrono::seconds window{10};
+  // search stops when the bracket is narrower than precision * rate
+  double precision = 0.05;
+
+  static SloSetting Make(const YAML::Node& node) {
+    SloSetting setting;
+    if (!node["latency"]) {
+      throw std::runtime_error("slo requires latency (us)");
+    }
+    setting.latency = std::chrono::microseconds(node["latency"].as<long>());
+    if (node["percentile"]) {
+      setting.percentile = node["percentile"].as<double>();
+    }
+    if (node["max_error_rate"]) {
+      setting.max_error_rate = node["max_error_rate"].as<double>();
+    }
+    if (node["min_rate"]) {
+      setting.min_rate = node["min_rate"].as<double>();
+    }
+    if (node["max_rate"]) {
+      setting.max_rate = node["max_rate"].as<double>();
+    }
+    if (node["window"]) {
+      setting.window = std::chrono::seconds(node["window"].as<long>());
+    }
+    if (node["precision"]) {
+      setting.precision = node["precision"].as<double>();
+    }
+
+    if (setting.percentile <= 0 || setting.percentile > 100) {
+      throw std::runtime_error("slo percentile must be in (0, 100]");
+    }
+    if (setting.min_rate <= 0 ||
+        (setting.max_rate > 0 && setting.max_rate < setting.min_rate)) {
+      throw std::runtime_error("invalid slo rate range");
+    }
+    if (setting.window.count() <= 0 || setting.precision <= 0) {
+      throw std::runtime_error("slo window and precision must be positive");
+    }
+    return setting;
+  }
+};
+
+// the same workload run several times, scalar: number of trials
+struct RepeatSetting {
+  std::size_t trials = 1;
+  // run before every trial: statements on a connection of their own,
+  // then a shell command (e.g. restoring a snapshot)
+  std::vector<std::string> reset_queries;
+  std::string reset_command;
+
+  static RepeatSetting Make(const YAML::Node& node) {
+    RepeatSetting setting;
+    if (node.IsScalar()) {
+      setting.trials = node.as<std::size_t>();
+    } else {
+      setting.trials = node["trials"].as<std::size_t>(setting.trials);
+      if (auto reset_node = node["reset"]) {
+        for (const auto& query_node : reset_node["queries"]) {
+          setting.reset_queries.emplace_back(query_node.as<std::string>());
+        }
+        setting.reset_command = reset_node["command"].as<std::string>("");
+      }
+    }
+    if (setting.trials == 0) {
+      throw std::runtime_error("repeat requires at least one trial");
+    }
+    return setting;
+  }
+};
+
+// largest relative change of a metric accepted when results are compared,
+// e.g. throughput 0.05 fails when throughput drops by more than 5%
+struct RegressionThresholds {
+  std::optional<double> throughput, average, median, p99, max;
+
+  static RegressionThresholds Make(const YAML::Node& node) {
+    RegressionThresholds thresholds;
+    const auto get = [&node](const char* key) -> std::optional<double> {
+      if (!node[key]) {
+        return std::nullopt;
+      }
+      const auto value = node[key].as<double>();
+      if (value < 0) {
+        throw std::runtime_error("regression threshold must not be negative");
+      }
+      return value;
+    };
+    thresholds.throughput = get("throughput");
+    thresholds.average = get("average");
+    thresholds.median = get("median");
+    thresholds.p99 = get("p99");
+    thresholds.max = get("max");
+    return thresholds;
+  }
+
+  static RegressionThresholds All(double value) {
+    if (value < 0) {
+      throw std::runtime_error("regression threshold must not be negative");
+    }
+    return {value, value, value, value, value};
+  }
+};
+
+// how transactions are sent to the targets of a properties file with
+// several of them. a scalar names the shard variable.
+struct RoutingSetting {
+  // {{ let }} variable whose value picks the primary target of a
+  // transaction, round robin over the primaries when empty or not bound
+  std::string shard_by;
+  // read only transactions go round robin to the replica targets
+  bool read_only_to_replicas = true;
+
+  static RoutingSetting Make(const YAML::Node& node) {
+    RoutingSetting setting;
+    if (node.IsScalar()) {
+      setting.shard_by = node.as<std::string>();
+      return setting;
+    }
+    setting.shard_by = node["shard_by"].as<std::string>("");
+    setting.read_only_to_replicas = node["read_only_to_replicas"].as<bool>(
+        setting.read_only_to_replicas);
+    return setting;
+  }
+};
+
+// transactions kept with their statements for the capture report. a
+// scalar is the number of both.
+struct CaptureSetting {
+  // slowest successful transactions of the run
+  std::size_t slowest = 0;
+  // errors sampled uniformly from all errors of the run
+  std::size_t errors = 0;
+
+  static CaptureSetting Make(const YAML::Node& node) {
+    CaptureSetting setting;
+    if (node.IsScalar()) {
+      setting.slowest = setting.errors = node.as<std::size_t>();
+      return setting;
+    }
+    setting.slowest = node["slowest"].as<std::size_t>(0);
+    setting.errors = node["errors"].as<std::size_t>(0);
+    return setting;
+  }
+
+  [[nodiscard]] bool enabled() const noexcept {
+    return slowest > 0 || errors > 0;
+  }
+};
+
+// one phase of the load schedule of a workload. threads and rate are a
+// number, or {from: a, to: b} for a linear ramp over the phase.
+struct PhaseSetting {
+  struct Ramp {
+    double from = 0.0, to = 0.0;
+
+    static Ramp Make(const YAML::Node& node) {
+      Ramp ramp;
+      if (node.IsScalar()) {
+        ramp.from = ramp.to = node.as<double>();
+      } else {
+        ramp.from = node["from"].as<double>();
+        ramp.to = node["to"].as<double>();
+      }
+      if (ramp.from < 0 || ramp.to < 0) {
+        throw std::runtime_error("phase threads and rate must not be "
+                                 "negative");
+      }
+      return ramp;
+    }
+
+    // progress through the phase from 0 to 1
+    [[nodiscard]] double at(double progress) const noexcept {
+      return from + (to - from) * progress;
+    }
+  };
+
+  std::string name;
+  // seconds in the workload
+  std::chrono::nanoseconds duration{0};
+  // active workers of all processes, every worker when unset
+  std::optional<Ramp> threads;
+  // transactions per second of the active workers, the rate of the
+  // workload when unset
+  std::optional<Ramp> rate;
+
+  static PhaseSetting Make(const YAML::Node& node, std::size_t index) {
+    PhaseSetting setting;
+    setting.name =
+        node["name"].as<std::string>("phase" + std::to_string(index));
+    setting.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(node["duration"].as<double>()));
+    if (setting.duration.count() <= 0) {
+      throw std::runtime_error("phase " + setting.name +
+                               " needs a positive duration (s)");
+    }
+    if (auto threads_node = node["threads"]) {
+      setting.threads = Ramp::Make(threads_node);
+    }
+    if (auto rate_node = node["rate"]) {
+      setting.rate = Ramp::Make(rate_node);
+    }
+    return setting;
+  }
+};
+
+// typed key value operation of a transaction, its key is rendered from the
+// template at the same index of the transaction
+struct OperationSetting {
+  database::Operation::Type type = database::Operation::Type::kRead;
+  std::string table, key_column = "ycsb_key", value_column = "field0";
+  std::size_t length = 1;
+  te::Template value;
+
+  static OperationSetting Make(const YAML::Node& node,
+                               te::SymbolTable& symbols) {
+    using Type = database::Operation::Type;
+
+    OperationSetting setting;
+    const auto type = node["operation"].as<std::string>();
+    if (type == "read") {
+      setting.type = Type::kRead;
+    } else if (type == "insert") {
+      setting.type = Type::kInsert;
+    } else if (type == "update") {
+      setting.type = Type::kUpdate;
+    } else if (type == "scan") {
+      setting.type = Type::kScan;
+    } else if (type == "delete") {
+      setting.type = Type::kDelete;
+    } else {
+      throw std::runtime_error("unknown operation " + type);
+    }
+
+    if (!node["table"] || !node["key"]) {
+      throw std::runtime_error("operation requires table and key");
+    }
+    setting.table = node["table"].as<std::string>();
+    setting.key_column = node["key_column"].as<std::string>(setting.key_column);
+    setting.value_column =
+        node["value_column"].as<std::string>(setting.value_column);
+    setting.length = node["length"].as<std::size_t>(setting.length);
+
+    if (setting.type == Type::kInsert || setting.type == Type::kUpdate) {
+      if (!node["value"]) {
+        throw std::runtime_error(type + " operation requires value");
+      }
+      setting.value =
+          te::Template::Compile(node["value"].as<std::string>(), symbols);
+    }
+    return setting;
+  }
+};
+
+// how transactions are started and ended, keys which are not given keep
+// the values of defaults (the workload level setting)
+struct TransactionControl {
+  database::TransactionOptions options;
+  // statements run without BEGIN/COMMIT
+  bool autocommit = false;
+  // share of transactions ended with ROLLBACK instead of COMMIT
+  double rollback_ratio = 0.0;
+  // every statement runs inside its own savepoint, a failed statement is
+  // rolled back to it and the transaction goes on
+  bool savepoints = false;
+
+  static TransactionControl Make(const YAML::Node& node) {
+    return Make(node, TransactionControl());
+  }
+
+  static TransactionControl Make(const YAML::Node& node,
+                                 TransactionControl defaults) {
+    using database::Isolation;
+
+    if (auto isolation_node = node["isolation"]) {
+      const auto isolation = isolation_node.as<std::string>();
+      if (isolation == "default") {
+        defaults.options.isolation = std::nullopt;
+      } else if (isolation == "read_uncommitted") {
+        defaults.options.isolation = Isolation::kReadUncommitted;
+      } else if (isolation == "read_committed") {
+        defaults.options.isolation = Isolation::kReadCommitted;
+      } else if (isolation == "repeatable_read") {
+        defaults.options.isolation = Isolation::kRepeatableRead;
+      } else if (isolation == "serializable") {
+        defaults.options.isolation = Isolation::kSerializable;
+      } else {
+        throw std::runtime_error("unknown isolation level " + isolation);
+      }
+    }
+    defaults.options.read_only =
+        node["read_only"].as<bool>(defaults.options.read_only);
+    defaults.autocommit = node["autocommit"].as<bool>(defaults.autocommit);
+    defaults.rollback_ratio =
+        node["rollback_ratio"].as<double>(defaults.rollback_ratio);
+    defaults.savepoints = node["savepoints"].as<bool>(defaults.savepoints);
+
+    if (defaults.rollback_ratio < 0 || defaults.rollback_ratio > 1) {
+      throw std::runtime_error("rollback_ratio must be in [0, 1]");
+    }
+    return defaults;
+  }
+
+  [[nodiscard]] const char* isolationName() const {
+    if (!options.isolation) {
+      return "default";
+    }
+    switch (*options.isolation) {
+      case database::Isolation::kReadUncommitted:
+        return "read_uncommitted";
+      case database::Isolation::kReadCommitted:
+        return "read_committed";
+      case database::Isolation::kRepeatableRead:
+        return "repeatable_read";
+      case database::Isolation::kSerializable:
+        break;
+    }
+    return "serializable";
+  }
+};
+
+struct TransactionSetting {
+  std::string name;
+  double weight = 1.0;
+  std::vector<std::string> queries;
+  // SQL text, or the key of the operation at the same index
+  std::vector<te::Template> templates;
+  std::vector<std::optional<OperationSetting>> operations;
+  // variables bound with {{ let }} live for one transaction
+  te::SymbolTable symbols;
+  ThinkTime keying_time, think_time;
+  TransactionControl control;
+
+  // keying time, think time and transaction control of the workload are
+  // used unless overwritten
+  static TransactionSetting Make(const YAML::Node& node, std::string name,
+                                 const ThinkTime& keying_time,
+                                 const ThinkTime& think_time,
+                                 const TransactionControl& control) {
+    TransactionSetting setting;
+    setting.name = node["name"].as<std::string>(std::move(name));
+    if (node["weight"]) {
+      setting.weight = node["weight"].as<double>();
+    }
+    if (setting.weight < 0) {
+      throw std::runtime_error("transaction weight must not be negative");
+    }
+
+    // SQL text or {operation: read, table: ..., key: ...}
+    auto queries_node = node["queries"];
+    setting.queries.reserve(std::size(queries_node));
+    setting.templates.reserve(std::size(queries_node));
+    setting.operations.reserve(std::size(queries_node));
+    for (const auto& query_node : queries_node) {
+      if (query_node.IsMap()) {
+        // the key is rendered before the value
+        setting.queries.emplace_back(query_node["key"].as<std::string>(""));
+        setting.templates.emplace_back(
+            te::Template::Compile(setting.queries.back(), setting.symbols));
+        setting.operations.emplace_back(
+            OperationSetting::Make(query_node, setting.symbols));
+        continue;
+      }
+      setting.queries.emplace_back(query_node.as<std::string>());
+      setting.templates.emplace_back(
+          te::Template::Compile(setting.queries.back(), setting.symbols));
+      setting.operations.emplace_back(std::nullopt);
+    }
+
+    setting.keying_time = node["keying_time"]
+                              ? ThinkTime::Make(node["keying_time"])
+                              : keying_time;
+    setting.think_time = node["think_time"]
+                             ? ThinkTime::Make(node["think_time"])
+                             : think_time;
+    setting.control =
+        node["transaction_control"]
+            ? TransactionControl::Make(node["transaction_control"], control)
+            : control;
+    return setting;
+  }
+};
+
+// threads of a workload which run their own transactions at their own
+// pace next to the other groups, e.g. OLTP next to a few analytical scans
+struct GroupSetting {
+  std::string name;
+  std::size_t threads = 0;
+  // transactions per thread
+  std::size_t count = 0;
+  // transactions per second of the group, 0 means unlimited
+  double rate = 0.0;
+  // indexes into the transactions of the workload
+  std::vector<std::size_t> transactions;
+};
+
+// rendered queries of one transaction and index of its setting
+struct Transaction {
+  std::size_t type;
+  std::vector<std::string> queries;
+};
+
 class Configuration {
  private:
   std::string name_;
-  std::vector<std::string> queries_;
+  std::vector<TransactionSetting> transactions_;
   std::size_t count_, thread_count_;
+  // forked worker processes, each running thread_count_ threads
+  std::size_t processes_ = 1;
+  // transactions per second of all threads, 0 means unlimited
+  double rate_ = 0.0;
+  // sample hardware counters of workers with perf_event_open
+  bool perf_counters_ = false;
+  // workers open a new timed connection every n transactions, 0 never
+  std::size_t reconnect_every_ = 0;
+  // unset: BEGIN/COMMIT around every transaction, 0: autocommit,
+  // n: COMMIT after every n statements, across transactions. a failure
+  // rolls back the whole batch, so its earlier transactions count as errors,
+  // and those of a batch rollback_ratio rolls back count as rollbacks
+  std::optional<std::size_t> statements_per_commit_;
+  // seeds the random generators of workers, random every run when unset
+  std::optional<std::uint64_t> seed_;
+  // latency clock source, steady or tsc
+  std::string timer_ = "steady";
+  RoutingSetting routing_;
+  CaptureSetting capture_;
+  // server metrics are sampled through a connection of their own this
+  // often when set
+  std::optional<std::chrono::milliseconds> server_metrics_;
+  RegressionThresholds regression_;
+  std::optional<SweepSetting> sweep_;
+  std::optional<SloSetting> slo_;
+  std::optional<RepeatSetting> repeat_;
+  // thread_count_ threads in groups of consecutive ones, empty when every
+  // thread runs the same transactions
+  std::vector<GroupSetting> groups_;
+  // phases run one after another, count then bounds the transactions of a
+  // thread
+  std::vector<PhaseSetting> schedule_;
 
  private:
-  Configuration(std::string name, std::vector<std::string> queries,
-                std::size_t count, std::size_t thread_count)
+  Configuration(std::string name,
+                std::vector<TransactionSetting> transactions, std::size_t count,
+                std::size_t thread_count)
       : name_(std::move(name)),
-        queries_(std::move(queries)),
+        transactions_(std::move(transactions)),
         count_(count),
         thread_count_(thread_count) {}
 
@@ -37,23 +554,150 @@ class Configuration {
 
     auto name = config["name"].as<std::string>();
 
+    // groups have their own threads and may have their own count
+    auto groups_node = config["groups"];
     auto count_node = config["count"];
-    const auto count = count_node.as<int>();
+    auto count = groups_node && !count_node ? 0 : count_node.as<int>();
 
     auto thread_count_node = config["threads"];
-    const auto thread_count = thread_count_node.as<int>();
+    if (groups_node && thread_count_node) {
+      throw std::runtime_error("threads of a workload with groups are set "
+                               "per group");
+    }
+    auto thread_count = groups_node ? 0 : thread_count_node.as<int>();
 
-    auto transaction_node = config["transaction"];
+    // name: path or name: {path: ..., delimiter: ",", header: true}
+    for (const auto& data_file : config["data_files"]) {
+      const auto file_name = data_file.first.as<std::string>();
+      const auto& file_node = data_file.second;
+      if (file_node.IsScalar()) {
+        DataFile::Load(file_name, file_node.as<std::string>());
+        continue;
+      }
+      const auto delimiter = file_node["delimiter"].as<std::string>(",");
+      if (std::size(delimiter) != 1) {
+        throw std::runtime_error("data file delimiter must be one character");
+      }
+      DataFile::Load(file_name, file_node["path"].as<std::string>(),
+                     delimiter[0], file_node["header"].as<bool>(false));
+    }
 
-    std::vector<std::string> queries;
-    auto queries_node = transaction_node["queries"];
-    queries.reserve(std::size(queries_node));
-    for (const auto& query_node : queries_node) {
-      queries.emplace_back(query_node.as<std::string>());
+    ThinkTime keying_time, think_time;
+    if (auto keying_time_node = config["keying_time"]) {
+      keying_time = ThinkTime::Make(keying_time_node);
+    }
+    if (auto think_time_node = config["think_time"]) {
+      think_time = ThinkTime::Make(think_time_node);
+    }
+    TransactionControl control;
+    if (auto control_node = config["transaction_control"]) {
+      control = TransactionControl::Make(control_node);
     }
 
-    return Configuration(std::move(name), std::move(queries), count,
-                         thread_count);
+    std::vector<TransactionSetting> transactions;
+    std::vector<GroupSetting> groups;
+    if (groups_node) {
+      if (config["transaction"] || config["transactions"] || config["rate"]) {
+        throw std::runtime_error("transactions and rate of a workload with "
+                                 "groups are set per group");
+      }
+      for (const auto& group_node : groups_node) {
+        auto& group = groups.emplace_back();
+        group.name = group_node["name"].as<std::string>(
+            "group" + std::to_string(std::size(groups) - 1));
+        group.threads = group_node["threads"].as<std::size_t>();
+        group.count = group_node["count"].as<std::size_t>(count);
+        group.rate = group_node["rate"].as<double>(0.0);
+        if (group.threads == 0 || group.count == 0 || group.rate < 0) {
+          throw std::runtime_error("group " + group.name +
+                                   " needs threads and count, and a rate "
+                                   "which is not negative");
+        }
+        // think times and transaction control of the workload are defaults
+        const auto first = std::size(transactions);
+        ParseTransactions(
+            group_node, group.name,
+            group_node["keying_time"]
+                ? ThinkTime::Make(group_node["keying_time"])
+                : keying_time,
+            group_node["think_time"] ? ThinkTime::Make(group_node["think_time"])
+                                     : think_time,
+            group_node["transaction_control"]
+                ? TransactionControl::Make(group_node["transaction_control"],
+                                           control)
+                : control,
+            transactions);
+        if (std::size(transactions) == first) {
+          throw std::runtime_error("no transaction is defined in group " +
+                                   group.name);
+        }
+        for (auto t = first; t < std::size(transactions); ++t) {
+          group.transactions.emplace_back(t);
+        }
+        thread_count += static_cast<int>(group.threads);
+        count = std::max(count, static_cast<int>(group.count));
+      }
+      if (std::empty(groups)) {
+        throw std::runtime_error("no group is defined");
+      }
+    } else {
+      ParseTransactions(config, name, keying_time, think_time, control,
+                        transactions);
+    }
+    if (std::empty(transactions)) {
+      throw std::runtime_error("no transaction is defined");
+    }
+
+    Configuration configuration(std::move(name), std::move(transactions),
+                                count, thread_count);
+    configuration.groups_ = std::move(groups);
+    if (auto rate_node = config["rate"]) {
+      configuration.rate(rate_node.as<double>());
+    }
+    configuration.processes(config["processes"].as<std::size_t>(1));
+    configuration.perf_counters_ = config["perf_counters"].as<bool>(false);
+    configuration.reconnect_every_ =
+        config["reconnect_every"].as<std::size_t>(0);
+    if (auto per_commit_node = config["statements_per_commit"]) {
+      configuration.statements_per_commit_ =
+          per_commit_node.as<std::size_t>();
+    }
+    if (auto seed_node = config["seed"]) {
+      configuration.seed_ = seed_node.as<std::uint64_t>();
+    }
+    configuration.timer_ = config["timer"].as<std::string>("steady");
+    if (auto routing_node = config["routing"]) {
+      configuration.routing_ = RoutingSetting::Make(routing_node);
+    }
+    for (const auto& phase_node : config["schedule"]) {
+      if (!std::empty(configuration.groups_)) {
+        throw std::runtime_error("a schedule cannot be used with groups");
+      }
+      configuration.schedule_.emplace_back(PhaseSetting::Make(
+          phase_node, std::size(configuration.schedule_)));
+    }
+    if (auto server_metrics_node = config["server_metrics"]) {
+      configuration.serverMetrics(std::chrono::milliseconds(
+          server_metrics_node.IsScalar()
+              ? server_metrics_node.as<long>()
+              : server_metrics_node["interval"].as<long>(1000)));
+    }
+    if (auto capture_node = config["capture"]) {
+      configuration.capture_ = CaptureSetting::Make(capture_node);
+    }
+    if (auto regression_node = config["regression"]) {
+      configuration.regression_ = RegressionThresholds::Make(regression_node);
+    }
+    if (auto sweep_node = config["sweep"]) {
+      configuration.sweep_ = SweepSetting::Make(sweep_node);
+    }
+    if (auto slo_node = config["slo"]) {
+      configuration.slo_ = SloSetting::Make(slo_node);
+    }
+    if (auto repeat_node = config["repeat"]) {
+      configuration.repeat_ = RepeatSetting::Make(repeat_node);
+    }
+    return configuration;
   }
 
   static Configuration Make(const std::string& config_file) {
@@ -64,52 +708,489 @@ class Configuration {
     return Make(fin);
   }
 
+ private:
+  // single "transaction" or weighted mix of "transactions" of node
+  static void ParseTransactions(const YAML::Node& node,
+                                const std::string& name,
+                                const ThinkTime& keying_time,
+                                const ThinkTime& think_time,
+                                const TransactionControl& control,
+                                std::vector<TransactionSetting>& transactions) {
+    if (auto transaction_node = node["transaction"]) {
+      transactions.emplace_back(TransactionSetting::Make(
+          transaction_node, name, keying_time, think_time, control));
+    }
+    if (auto transactions_node = node["transactions"]) {
+      for (const auto& transaction_node : transactions_node) {
+        transactions.emplace_back(TransactionSetting::Make(
+            transaction_node,
+            "transaction" + std::to_string(std::size(transactions)),
+            keying_time, think_time, control));
+      }
+    }
+  }
+
  public:
   [[nodiscard]] const std::string& name() const noexcept { return name_; }
 
-  void threadCount(std::size_t count) noexcept { thread_count_ = count; }
+  void threadCount(std::size_t count) {
+    if (!std::empty(groups_)) {
+      throw std::runtime_error("threads of a workload with groups are set "
+                               "per group");
+    }
+    thread_count_ = count;
+  }
 
   [[nodiscard]] std::size_t threadCount() const noexcept {
     return thread_count_;
   }
 
-  [[nodiscard]] const std::vector<std::string>& queries() const noexcept {
-    return queries_;
+  void processes(std::size_t processes) {
+    if (processes == 0) {
+      throw std::runtime_error("processes must be at least 1");
+    }
+    processes_ = processes;
+  }
+
+  [[nodiscard]] std::size_t processes() const noexcept { return processes_; }
+
+  void rate(double rate) {
+    if (!std::empty(groups_)) {
+      throw std::runtime_error("rate of a workload with groups is set per "
+                               "group");
+    }
+    if (rate < 0) {
+      throw std::runtime_error("rate must not be negative");
+    }
+    rate_ = rate;
   }
 
-  [[nodiscard]] std::size_t count() const noexcept { return count_; }
+  [[nodiscard]] double rate() const noexcept { return rate_; }
 
-  [[nodiscard]] std::vector<std::vector<std::string>> createQueries() const {
-    std::vector<std::vector<std::string>> whole_queries;
-    whole_queries.reserve(count());
+  [[nodiscard]] bool perfCounters() const noexcept { return perf_counters_; }
 
-    const auto& original_queries = queries();
+  void reconnectEvery(std::size_t count) noexcept { reconnect_every_ = count; }
 
-    for (std::size_t i = 0; i < count(); ++i) {
-      std::vector<std::string> queries_each_transaction;
-      queries_each_transaction.reserve(2 + std::size(original_queries));
+  [[nodiscard]] std::size_t reconnectEvery() const noexcept {
+    return reconnect_every_;
+  }
 
-      queries_each_transaction.emplace_back("BEGIN");
-      for (const auto& query : original_queries) {
-        queries_each_transaction.emplace_back(CreateString(query));
-      }
-      queries_each_transaction.emplace_back("COMMIT");
+  void statementsPerCommit(std::optional<std::size_t> count) noexcept {
+    statements_per_commit_ = count;
+  }
 
-      whole_queries.emplace_back(queries_each_transaction);
+  [[nodiscard]] const std::optional<std::size_t>& statementsPerCommit()
+      const noexcept {
+    return statements_per_commit_;
+  }
+
+  void seed(std::optional<std::uint64_t> seed) noexcept { seed_ = seed; }
+
+  [[nodiscard]] const std::optional<std::uint64_t>& seed() const noexcept {
+    return seed_;
+  }
+
+  void timer(std::string source) { timer_ = std::move(source); }
+
+  [[nodiscard]] const std::string& timer() const noexcept { return timer_; }
+
+  void routing(RoutingSetting setting) { routing_ = std::move(setting); }
+
+  [[nodiscard]] const RoutingSetting& routing() const noexcept {
+    return routing_;
+  }
+
+  void capture(const CaptureSetting& setting) { capture_ = setting; }
+
+  [[nodiscard]] const CaptureSetting& capture() const noexcept {
+    return capture_;
+  }
+
+  void serverMetrics(std::chrono::milliseconds interval) {
+    if (interval.count() <= 0) {
+      throw std::runtime_error("server metrics interval must be positive");
     }
+    server_metrics_ = interval;
+  }
+
+  [[nodiscard]] const std::optional<std::chrono::milliseconds>& serverMetrics()
+      const noexcept {
+    return server_metrics_;
+  }
+
+  void regression(const RegressionThresholds& thresholds) {
+    regression_ = thresholds;
+  }
 
-    return whole_queries;
+  [[nodiscard]] const RegressionThresholds& regression() const noexcept {
+    return regression_;
   }
 
+  void sweep(SweepSetting setting) { sweep_ = setting; }
+
+  [[nodiscard]] const std::optional<SweepSetting>& sweep() const noexcept {
+    return sweep_;
+  }
+
+  [[nodiscard]] const std::optional<SloSetting>& slo() const noexcept {
+    return slo_;
+  }
+
+  void repeat(RepeatSetting setting) { repeat_ = std::move(setting); }
+
+  [[nodiscard]] const std::optional<RepeatSetting>& repeat() const noexcept {
+    return repeat_;
+  }
+
+  [[nodiscard]] const std::vector<TransactionSetting>& transactions()
+      const noexcept {
+    return transactions_;
+  }
+
+  void count(std::size_t count) noexcept { count_ = count; }
+
+  // transactions per thread, the largest of the groups when there are some
+  [[nodiscard]] std::size_t count() const noexcept { return count_; }
+
+  [[nodiscard]] const std::vector<GroupSetting>& groups() const noexcept {
+    return groups_;
+  }
+
+  [[nodiscard]] const std::vector<PhaseSetting>& schedule() const noexcept {
+    return schedule_;
+  }
+
+  // group of a thread of a process, nullptr without groups
+  [[nodiscard]] const GroupSetting* group(std::size_t thread_id) const {
+    for (const auto& group : groups_) {
+      if (thread_id < group.threads) {
+        return &group;
+      }
+      thread_id -= group.threads;
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] std::vector<Transaction> createQueries() const;
+
   [[nodiscard]] std::vector<std::string> createWholeQueries() const {
     std::vector<std::string> queries;
 
-    for (const auto& query_in_transaction : createQueries()) {
-      queries.insert(std::end(queries), std::begin(query_in_transaction),
-                     std::end(query_in_transaction));
+    for (const auto& transaction : createQueries()) {
+      queries.insert(std::end(queries), std::begin(transaction.queries),
+                     std::end(transaction.queries));
     }
     return queries;
   }
 };
 
+// renders transactions of one worker into buffers reused between calls
+class TransactionGenerator {
+ private:
+  const Configuration& config_;
+  std::discrete_distribution<std::size_t> choose_;
+  std::vector<std::string> buffers_, values_;
+  te::Scope scope_;
+  std::size_t type_ = 0;
+
+ public:
+  // only the transactions of group are chosen when it is given
+  explicit TransactionGenerator(const Configuration& config,
+                                const GroupSetting* group = nullptr)
+      : config_(config) {
+    const auto& transactions = config.transactions();
+    std::vector<double> weights(std::size(transactions));
+    if (group) {
+      for (const auto t : group->transactions) {
+        weights[t] = transactions[t].weight;
+      }
+    } else {
+      std::transform(std::begin(transactions), std::end(transactions),
+                     std::begin(weights),
+                     [](const TransactionSetting& t) { return t.weight; });
+    }
+    choose_ = std::discrete_distribution<std::size_t>(std::begin(weights),
+                                                      std::end(weights));
+  }
+
+ public:
+  // chooses a transaction type and renders its queries
+  const TransactionSetting& next() {
+    auto& worker = te::CurrentWorker();
+    ++worker.transaction_index;
+    type_ = choose_(worker.random);
+    const auto& setting = config_.transactions()[type_];
+
+    if (std::size(buffers_) < std::size(setting.templates)) {
+      buffers_.resize(std::size(setting.templates));
+      values_.resize(std::size(setting.templates));
+    }
+    scope_.reset(setting.symbols.size());
+    for (std::size_t i = 0; i < std::size(setting.templates); ++i) {
+      buffers_[i].clear();
+      setting.templates[i].render(buffers_[i], scope_);
+      if (const auto& operation = setting.operations[i]) {
+        values_[i].clear();
+        operation->value.render(values_[i], scope_);
+      }
+    }
+    return setting;
+  }
+
+  [[nodiscard]] std::size_t type() const noexcept { return type_; }
+
+  [[nodiscard]] const TransactionSetting& setting() const noexcept {
+    return config_.transactions()[type_];
+  }
+
+  // value a {{ let }} variable of the last transaction is bound to
+  [[nodiscard]] const te::Value& variable(std::size_t slot) const {
+    return scope_.get(slot);
+  }
+
+  // queries of the last transaction, valid until the next call of next()
+  [[nodiscard]] std::size_t size() const noexcept {
+    return std::size(config_.transactions()[type_].templates);
+  }
+
+  // SQL text, or the key when the statement is an operation
+  [[nodiscard]] std::string_view query(std::size_t index) const noexcept {
+    return buffers_[index];
+  }
+
+  [[nodiscard]] std::optional<database::Operation> operation(
+      std::size_t index) const {
+    const auto& setting = config_.transactions()[type_].operations[index];
+    if (!setting) {
+      return std::nullopt;
+    }
+    database::Operation operation;
+    operation.type = setting->type;
+    operation.table = setting->table;
+    operation.key = buffers_[index];
+    operation.value = values_[index];
+    operation.length = setting->length;
+    operation.key_column = setting->key_column;
+    operation.value_column = setting->value_column;
+    return operation;
+  }
+
+  // sends a statement of the last transaction to db
+  void execute(std::size_t index, database::Database& db) const {
+    if (const auto operation = this->operation(index)) {
+      db.operate(*operation);
+    } else {
+      db.execute(buffers_[index]);
+    }
+  }
+
+  std::mt19937_64& random() noexcept { return te::CurrentWorker().random; }
+};
+
+// begins, commits and rolls back database transactions of one worker
+// following the transaction control of each transaction and
+// statements_per_commit of the workload
+class TransactionController {
+ private:
+  inline static constexpr std::string_view kSavepoint = "tb_savepoint";
+
+  std::optional<std::size_t> statements_per_commit_;
+  std::size_t uncommitted_ = 0;
+  // successful runs with statements in the open transaction
+  std::size_t pending_ = 0;
+  bool in_transaction_ = false;
+  // of the last run()
+  bool rolled_back_ = false;
+  // earlier successful runs of the batch which rollback_ratio rolled back
+  std::size_t rolled_back_runs_ = 0;
+  std::size_t savepoints_ = 0, savepoint_rollbacks_ = 0;
+  // time of each statement of the last run(), only when enabled
+  bool time_statements_ = false;
+  std::vector<Clock::duration> statement_times_;
+
+ public:
+  explicit TransactionController(const Configuration& config)
+      : statements_per_commit_(config.statementsPerCommit()) {}
+
+ public:
+  // sends the last transaction of generator, errors are thrown
+  void run(const TransactionGenerator& generator, database::Database& db,
+           std::mt19937_64& random) {
+    const auto& control = generator.setting().control;
+    rolled_back_ = false;
+    rolled_back_runs_ = 0;
+    savepoints_ = savepoint_rollbacks_ = 0;
+    statement_times_.clear();
+
+    const auto explicit_transaction =
+        !control.autocommit &&
+        (!statements_per_commit_ || *statements_per_commit_ > 0);
+    if (!explicit_transaction) {
+      rolled_back_runs_ += end(db, control, random);
+    }
+
+    for (std::size_t q = 0; q < generator.size(); ++q) {
+      if (explicit_transaction && !in_transaction_) {
+        db.begin(control.options);
+        in_transaction_ = true;
+      }
+
+      if (control.savepoints && in_transaction_) {
+        db.savepoint(kSavepoint);
+        ++savepoints_;
+        try {
+          execute(generator, q, db);
+          db.releaseSavepoint(kSavepoint);
+        } catch (const database::DatabaseError&) {
+          db.rollbackToSavepoint(kSavepoint);
+          ++savepoint_rollbacks_;
+        }
+      } else {
+        execute(generator, q, db);
+      }
+
+      if (statements_per_commit_ && *statements_per_commit_ > 0 &&
+          ++uncommitted_ == *statements_per_commit_) {
+        rolled_back_runs_ += end(db, control, random);
+      }
+    }
+    if (!statements_per_commit_) {
+      rolled_back_runs_ += end(db, control, random);
+    }
+    if (in_transaction_) {
+      ++pending_;
+    }
+  }
+
+  // rolls back the transaction left by a failed run(). returns how many
+  // earlier successful runs of the batch were rolled back with it.
+  std::size_t abort(database::Database& db) noexcept {
+    // a failed commit of the batch left it already
+    const auto discarded = std::exchange(pending_, 0);
+    if (!in_transaction_) {
+      return discarded;
+    }
+    in_transaction_ = false;
+    uncommitted_ = 0;
+    try {
+      db.rollback();
+    } catch (...) {
+    }
+    return discarded;
+  }
+
+  // commits statements of an incomplete batch. returns how many successful
+  // runs were lost because the commit failed.
+  std::size_t finish(database::Database& db) noexcept {
+    if (!in_transaction_) {
+      return 0;
+    }
+    const auto pending = pending_;
+    in_transaction_ = false;
+    uncommitted_ = pending_ = 0;
+    try {
+      db.commit();
+    } catch (...) {
+      return pending;
+    }
+    return 0;
+  }
+
+  // successful runs the next commit or rollback of the batch decides on
+  [[nodiscard]] std::size_t pending() const noexcept { return pending_; }
+
+  // keeps the time of every statement, which costs two clock reads each
+  void timeStatements(bool enabled, std::size_t max_statements) {
+    time_statements_ = enabled;
+    statement_times_.reserve(enabled ? max_statements : 0);
+  }
+
+  // of the statements sent by the last run(), the failed one included
+  [[nodiscard]] const std::vector<Clock::duration>& statementTimes()
+      const noexcept {
+    return statement_times_;
+  }
+
+  [[nodiscard]] bool rolledBack() const noexcept { return rolled_back_; }
+  [[nodiscard]] std::size_t rolledBackRuns() const noexcept {
+    return rolled_back_runs_;
+  }
+  [[nodiscard]] std::size_t savepoints() const noexcept { return savepoints_; }
+  [[nodiscard]] std::size_t savepointRollbacks() const noexcept {
+    return savepoint_rollbacks_;
+  }
+
+ private:
+  void execute(const TransactionGenerator& generator, std::size_t index,
+               database::Database& db) {
+    if (!time_statements_) {
+      generator.execute(index, db);
+      return;
+    }
+    const auto begin = Clock::now();
+    try {
+      generator.execute(index, db);
+    } catch (...) {
+      statement_times_.emplace_back(Clock::now() - begin);
+      throw;
+    }
+    statement_times_.emplace_back(Clock::now() - begin);
+  }
+
+  // returns how many earlier successful runs of the batch were rolled back
+  std::size_t end(database::Database& db, const TransactionControl& control,
+                  std::mt19937_64& random) {
+    if (!in_transaction_) {
+      return 0;
+    }
+    in_transaction_ = false;
+    uncommitted_ = 0;
+    if (control.rollback_ratio > 0 &&
+        std::bernoulli_distribution(control.rollback_ratio)(random)) {
+      rolled_back_ = true;
+      db.rollback();
+      return std::exchange(pending_, 0);
+    }
+    db.commit();
+    pending_ = 0;
+    return 0;
+  }
+};
+
+inline std::vector<Transaction> Configuration::createQueries() const {
+  // collects what the controller would send
+  class Recorder : public database::Database {
+   public:
+    std::vector<std::string>* queries = nullptr;
+
+    void execute(std::string_view query) override {
+      queries->emplace_back(query);
+    }
+  };
+
+  std::vector<Transaction> whole_queries;
+  whole_queries.reserve(count());
+
+  TransactionGenerator generator(*this);
+  TransactionController controller(*this);
+  Recorder recorder;
+  for (std::size_t i = 0; i < count(); ++i) {
+    generator.next();
+
+    std::vector<std::string> queries_each_transaction;
+    queries_each_transaction.reserve(2 + generator.size());
+    recorder.queries = &queries_each_transaction;
+    controller.run(generator, recorder, generator.random());
+
+    whole_queries.push_back(
+        {generator.type(), std::move(queries_each_transaction)});
+  }
+  if (!std::empty(whole_queries)) {
+    recorder.queries = &whole_queries.back().queries;
+    controller.finish(recorder);
+  }
+
+  return whole_queries;
+}
+
 }  // namespace tb
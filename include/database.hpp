@@ -4,17 +4,308 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 namespace tb::database {
 
+enum class ErrorClass : std::size_t {
+  kConnection,
+  kSerialization,
+  kDeadlock,
+  kConstraint,
+  kTimeout,
+  kOther,
+};
+
+inline constexpr std::size_t kErrorClassCount = 6;
+
+inline const char* ToString(ErrorClass error_class) {
+  switch (error_class) {
+    case ErrorClass::kConnection:
+      return "connection";
+    case ErrorClass::kSerialization:
+      return "serialization";
+    case ErrorClass::kDeadlock:
+      return "deadlock";
+    case ErrorClass::kConstraint:
+      return "constraint";
+    case ErrorClass::kTimeout:
+      return "timeout";
+    case ErrorClass::kOther:
+      break;
+  }
+  return "other";
+}
+
+// error reported by a database with its native code (SQLSTATE, errno, ...)
+class DatabaseError : public std::runtime_error {
+ private:
+  ErrorClass error_class_;
+  std::string code_;
+
+ public:
+  DatabaseError(const std::string& message, ErrorClass error_class,
+                std::string code)
+      : std::runtime_error(message),
+        error_class_(error_class),
+        code_(std::move(code)) {}
+
+ public:
+  [[nodiscard]] ErrorClass errorClass() const noexcept { return error_class_; }
+  [[nodiscard]] const std::string& code() const noexcept { return code_; }
+};
+
+// typed key value operation, keys and values are arbitrary bytes
+struct Operation {
+  enum class Type {
+    kRead,
+    kInsert,
+    kUpdate,
+    kScan,
+    kDelete,
+  };
+
+  Type type = Type::kRead;
+  std::string_view table;
+  std::string_view key;
+  std::string_view value;
+  // records read by a scan starting at key
+  std::size_t length = 1;
+  // columns used when the operation is rendered as SQL
+  std::string_view key_column = "ycsb_key";
+  std::string_view value_column = "field0";
+};
+
+inline const char* ToString(Operation::Type type) {
+  switch (type) {
+    case Operation::Type::kRead:
+      return "read";
+    case Operation::Type::kInsert:
+      return "insert";
+    case Operation::Type::kUpdate:
+      return "update";
+    case Operation::Type::kScan:
+      return "scan";
+    case Operation::Type::kDelete:
+      break;
+  }
+  return "delete";
+}
+
+// quoted literal, values with quotes, backslashes or binary bytes are written
+// as X'..' hex literals, which MySQL takes as binary strings. PostgreSQL
+// reads X'..' as a bit string, its backend binds operations as parameters
+// instead.
+inline void AppendLiteral(std::string& out, std::string_view value) {
+  const auto is_plain = std::all_of(
+      std::begin(value), std::end(value), [](char c) {
+        return c >= 0x20 && c < 0x7f && c != '\\' && c != '\'';
+      });
+  if (is_plain) {
+    out += '\'';
+    out += value;
+    out += '\'';
+    return;
+  }
+
+  constexpr char kHex[] = "0123456789abcdef";
+  out += "X'";
+  for (const auto c : value) {
+    const auto byte = static_cast<unsigned char>(c);
+    out += kHex[byte >> 4];
+    out += kHex[byte & 0x0f];
+  }
+  out += '\'';
+}
+
+// appends the SQL equivalent of an operation, key and value are written by
+// literal(out, value, parameter), parameter is 1 for the key and 2 for the
+// value
+template <class Literal>
+void AppendSql(std::string& out, const Operation& operation,
+               Literal&& literal) {
+  const auto where_key = [&] {
+    out += " WHERE ";
+    out += operation.key_column;
+    out += " = ";
+    literal(out, operation.key, 1);
+  };
+
+  switch (operation.type) {
+    case Operation::Type::kRead:
+      out += "SELECT * FROM ";
+      out += operation.table;
+      where_key();
+      break;
+    case Operation::Type::kInsert:
+      out += "INSERT INTO ";
+      out += operation.table;
+      out += " (";
+      out += operation.key_column;
+      out += ", ";
+      out += operation.value_column;
+      out += ") VALUES (";
+      literal(out, operation.key, 1);
+      out += ", ";
+      literal(out, operation.value, 2);
+      out += ')';
+      break;
+    case Operation::Type::kUpdate:
+      out += "UPDATE ";
+      out += operation.table;
+      out += " SET ";
+      out += operation.value_column;
+      out += " = ";
+      literal(out, operation.value, 2);
+      where_key();
+      break;
+    case Operation::Type::kScan: {
+      out += "SELECT * FROM ";
+      out += operation.table;
+      out += " WHERE ";
+      out += operation.key_column;
+      out += " >= ";
+      literal(out, operation.key, 1);
+      out += " ORDER BY ";
+      out += operation.key_column;
+      out += " LIMIT ";
+      std::array<char, 24> digits{};
+      const auto [end, ec] = std::to_chars(
+          digits.data(), digits.data() + digits.size(), operation.length);
+      static_cast<void>(ec);
+      out.append(digits.data(), end);
+      break;
+    }
+    case Operation::Type::kDelete:
+      out += "DELETE FROM ";
+      out += operation.table;
+      where_key();
+      break;
+  }
+}
+
+// with the key and the value as literals
+inline void AppendSql(std::string& out, const Operation& operation) {
+  AppendSql(out, operation, [](std::string& o, std::string_view value, int) {
+    AppendLiteral(o, value);
+  });
+}
+
+enum class Isolation {
+  kReadUncommitted,
+  kReadCommitted,
+  kRepeatableRead,
+  kSerializable,
+};
+
+inline const char* ToSql(Isolation isolation) {
+  switch (isolation) {
+    case Isolation::kReadUncommitted:
+      return "READ UNCOMMITTED";
+    case Isolation::kReadCommitted:
+      return "READ COMMITTED";
+    case Isolation::kRepeatableRead:
+      return "REPEATABLE READ";
+    case Isolation::kSerializable:
+      break;
+  }
+  return "SERIALIZABLE";
+}
+
+// characteristics of a transaction, unset ones are server defaults
+struct TransactionOptions {
+  std::optional<Isolation> isolation;
+  bool read_only = false;
+};
+
+// BEGIN, or START TRANSACTION with characteristics as SQL:1999 defines them
+inline void AppendBegin(std::string& out, const TransactionOptions& options) {
+  if (!options.isolation && !options.read_only) {
+    out += "BEGIN";
+    return;
+  }
+  out += "START TRANSACTION";
+  if (options.isolation) {
+    out += " ISOLATION LEVEL ";
+    out += ToSql(*options.isolation);
+  }
+  if (options.read_only) {
+    out += options.isolation ? ", READ ONLY" : " READ ONLY";
+  }
+}
+
+// a statistic of the server read by the sampler while a benchmark runs
+struct ServerMetric {
+  std::string name;
+  double value;
+  // counters are reported as their change between samples, gauges as is
+  bool counter = true;
+};
+
 class Database {
+ private:
+  std::string sql_buffer_;
+
+ public:
+  // column name and text of each column, NULL as an empty string
+  using Row = std::vector<std::pair<std::string, std::string>>;
+
  public:
   virtual ~Database() = default;
 
  public:
   virtual void execute(std::string_view) = 0;
+
+  // rows of a query, for backends which can return them
+  virtual std::vector<Row> query(std::string_view) {
+    throw std::runtime_error("backend does not return rows");
+  }
+
+  // counters and gauges of the server, none unless the backend knows where
+  // to read them
+  virtual std::vector<ServerMetric> serverMetrics() { return {}; }
+
+  // backends with a native key value protocol override this,
+  // others receive the operation rendered as SQL
+  virtual void operate(const Operation& operation) {
+    sql_buffer_.clear();
+    AppendSql(sql_buffer_, operation);
+    execute(sql_buffer_);
+  }
+
+  // transaction control, backends override these when their syntax differs
+  virtual void begin(const TransactionOptions& options) {
+    sql_buffer_.clear();
+    AppendBegin(sql_buffer_, options);
+    execute(sql_buffer_);
+  }
+
+  virtual void commit() { execute("COMMIT"); }
+  virtual void rollback() { execute("ROLLBACK"); }
+
+  virtual void savepoint(std::string_view name) {
+    sql_buffer_.assign("SAVEPOINT ").append(name);
+    execute(sql_buffer_);
+  }
+
+  virtual void releaseSavepoint(std::string_view name) {
+    sql_buffer_.assign("RELEASE SAVEPOINT ").append(name);
+    execute(sql_buffer_);
+  }
+
+  virtual void rollbackToSavepoint(std::string_view name) {
+    sql_buffer_.assign("ROLLBACK TO SAVEPOINT ").append(name);
+    execute(sql_buffer_);
+  }
 };
 
 }  // namespace tb::database
@@ -12,6 +12,7 @@
 #include "properties.hpp"
 
 // provided databases
+#include "memory.hpp"
 #include "mysql.hpp"
 #include "stdout.hpp"
 
@@ -43,6 +44,8 @@ GetDatabaseCreator(const std::string& name) {
     return [](const Properties& p) { return MySQL::Make(p); };
   } else if (name == "postgresql") {
     return [](const Properties& p) { return PostgreSQL::Make(p); };
+  } else if (name == "memory") {
+    return [](const Properties& p) { return MemoryDatabase::Make(p); };
   }
   const auto func = GetNoTrackDatabaseCreator(name);
   if (func) {
@@ -7,9 +7,12 @@
 #include <fstream>
 #include <istream>
 #include <optional>
+#include <set>
+#include <sstream>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 namespace tb {
 
@@ -106,6 +109,49 @@ class Properties {
     const auto value = get<IntegralT>(key);
     return value ? *value : default_value;
   }
+
+ public:
+  // names of the targets of a file with target.<name>.<key> entries, in the
+  // order of the targets entry (comma separated) or sorted by name
+  [[nodiscard]] std::vector<std::string> targets() const {
+    std::vector<std::string> names;
+    if (const auto list = getProperty("targets")) {
+      std::istringstream is(*list);
+      for (std::string name; std::getline(is, name, ',');) {
+        if (!name.empty()) {
+          names.emplace_back(std::move(name));
+        }
+      }
+      return names;
+    }
+
+    std::set<std::string> found;
+    for (const auto& [key, value] : values_) {
+      if (key.compare(0, kTargetPrefix.size(), kTargetPrefix) == 0) {
+        const auto end = key.find('.', kTargetPrefix.size());
+        if (end != std::string::npos) {
+          found.emplace(key.substr(kTargetPrefix.size(),
+                                   end - kTargetPrefix.size()));
+        }
+      }
+    }
+    return {std::begin(found), std::end(found)};
+  }
+
+  // properties of a target, keys it does not set are taken from the file
+  [[nodiscard]] Properties target(const std::string& name) const {
+    auto values = values_;
+    const auto prefix = kTargetPrefix + name + ".";
+    for (const auto& [key, value] : values_) {
+      if (key.compare(0, prefix.size(), prefix) == 0) {
+        values[key.substr(prefix.size())] = value;
+      }
+    }
+    return Properties{std::move(values)};
+  }
+
+ private:
+  inline static const std::string kTargetPrefix = "target.";
 };
 
 }  // namespace tb
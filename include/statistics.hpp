@@ -6,36 +6,164 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <map>
 #include <numeric>
+#include <optional>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
 namespace tb {
 
+// resources used by one worker thread while it ran transactions
+struct ClientUsage {
+  struct Perf {
+    std::uint64_t cycles, instructions, cache_misses;
+  };
+
+  std::chrono::microseconds cpu_time{0};
+  // wall time spent rendering, inside the driver and pausing
+  std::chrono::microseconds generation{0}, driver{0}, wait{0};
+  long voluntary_switches = 0, involuntary_switches = 0;
+  std::optional<Perf> perf;
+};
+
+// connections made by workers that reconnect while running, in nanoseconds
+struct ConnectionTimes {
+  std::vector<std::chrono::nanoseconds> connect;
+  // latency of the first transaction on each new connection
+  std::vector<std::chrono::nanoseconds> first_transaction;
+  std::size_t errors = 0;
+};
+
+// failed transactions and latencies of the successful ones of a part of a
+// run, such as a transaction type, a target, a group or a phase
+struct LatencyStatistics {
+  std::size_t errors = 0;
+  // successful transactions, in nanoseconds
+  std::vector<std::chrono::nanoseconds> latencies;
+
+  // adds the transactions of the same part from another thread
+  void merge(const LatencyStatistics& other) {
+    errors += other.errors;
+    latencies.insert(std::end(latencies), std::begin(other.latencies),
+                     std::end(other.latencies));
+  }
+};
+
+// outcome of the transactions of one type of the workload. latencies are of
+// committed and intentionally rolled back transactions.
+struct TransactionTypeStatistics : LatencyStatistics {
+  std::string name;
+  std::string isolation = "default";
+  bool read_only = false;
+  std::size_t commits = 0, rollbacks = 0;
+  std::size_t savepoints = 0, savepoint_rollbacks = 0;
+
+  void merge(const TransactionTypeStatistics& other) {
+    LatencyStatistics::merge(other);
+    commits += other.commits;
+    rollbacks += other.rollbacks;
+    savepoints += other.savepoints;
+    savepoint_rollbacks += other.savepoint_rollbacks;
+  }
+};
+
+// transactions routed to one target of a run with several of them
+struct TargetStatistics : LatencyStatistics {
+  std::string name;
+  // primary or replica
+  std::string role = "primary";
+};
+
+// transactions of one thread group of a workload with several of them
+struct GroupStatistics : LatencyStatistics {
+  std::string name;
+  std::size_t threads = 0;
+  // longest time a thread of the group ran its transactions
+  std::chrono::nanoseconds duration{0};
+};
+
+// transactions started in one phase of the load schedule
+struct PhaseStatistics : LatencyStatistics {
+  std::string name;
+  // as scheduled, since the start of the run
+  std::chrono::nanoseconds start{0}, duration{0};
+};
+
+// client and server side of one interval of the server metrics sampler
+struct MetricsSample {
+  // end of the interval since the start of the run, in nanoseconds
+  std::chrono::nanoseconds time{0};
+  // transactions which completed in the interval
+  std::uint64_t success = 0, errors = 0;
+  // of them in microseconds, p99 is the upper bound of its latency bucket
+  double average = 0.0, p99 = 0.0;
+  // change of counters and value of gauges, unset when not read
+  std::vector<std::optional<double>> server;
+};
+
+struct ServerMetricsSeries {
+  // of the server values of the samples
+  std::vector<std::string> names;
+  std::vector<MetricsSample> samples;
+};
+
+// one transaction kept by the capture of a run with its statements
+struct CapturedTransaction {
+  std::string type;
+  std::size_t thread = 0;
+  // since the start of the run, in nanoseconds
+  std::chrono::nanoseconds start{0}, latency{0};
+  // rendered SQL, operations as the SQL a SQL backend sends for them
+  std::vector<std::string> statements;
+  // of the statements which were sent, the failed one is the last
+  std::vector<std::chrono::nanoseconds> timings;
+  // message of the error, empty for successes
+  std::string error;
+};
+
 class Statistics {
  public:
-  using ElapsedTimeType = std::chrono::microseconds;
+  using ElapsedTimeType = std::chrono::nanoseconds;
   using ElapsedTimesType = std::vector<ElapsedTimeType>;
   using ElapsedTImesPerThreadType =
       std::tuple<ElapsedTimesType, ElapsedTimesType>;
 
- private:
+ public:
   inline static constexpr std::size_t kSuccessIndex = 0, kErrorIndex = 1;
 
  private:
   std::string name_;
   std::size_t thread_count_;
   std::vector<ElapsedTImesPerThreadType> elapsed_times_;
+  ElapsedTimeType duration_;
+  std::vector<ClientUsage> client_usages_;
+  ConnectionTimes connections_;
+  std::vector<TransactionTypeStatistics> transaction_types_;
+  std::vector<TargetStatistics> targets_;
+  std::vector<GroupStatistics> groups_;
+  std::vector<PhaseStatistics> phases_;
+  ServerMetricsSeries server_metrics_;
+  // slowest first, errors by their start
+  std::vector<CapturedTransaction> slowest_, sampled_errors_;
+  // clock used for latencies and the cost of reading it once
+  std::string timer_source_;
+  ElapsedTimeType timer_overhead_{0};
 
  public:
   Statistics(std::string name, std::size_t thread_count,
-             std::vector<ElapsedTImesPerThreadType> elapsed_times)
+             std::vector<ElapsedTImesPerThreadType> elapsed_times,
+             ElapsedTimeType duration = ElapsedTimeType(0))
       : name_(std::move(name)),
         thread_count_(thread_count),
-        elapsed_times_(std::move(elapsed_times)) {}
+        elapsed_times_(std::move(elapsed_times)),
+        duration_(duration) {}
 
  public:
   [[nodiscard]] const std::string& name() const noexcept { return name_; }
@@ -43,10 +171,107 @@ class Statistics {
     return thread_count_;
   }
 
+  // wall clock time from the start barrier to the last worker finishing
+  [[nodiscard]] ElapsedTimeType duration() const noexcept { return duration_; }
+
+  void clientUsages(std::vector<ClientUsage> usages) {
+    client_usages_ = std::move(usages);
+  }
+
+  [[nodiscard]] const std::vector<ClientUsage>& clientUsages() const noexcept {
+    return client_usages_;
+  }
+
+  void connections(ConnectionTimes connections) {
+    connections_ = std::move(connections);
+  }
+
+  [[nodiscard]] const ConnectionTimes& connections() const noexcept {
+    return connections_;
+  }
+
+  void transactionTypes(std::vector<TransactionTypeStatistics> types) {
+    transaction_types_ = std::move(types);
+  }
+
+  [[nodiscard]] const std::vector<TransactionTypeStatistics>&
+  transactionTypes() const noexcept {
+    return transaction_types_;
+  }
+
+  void targets(std::vector<TargetStatistics> targets) {
+    targets_ = std::move(targets);
+  }
+
+  [[nodiscard]] const std::vector<TargetStatistics>& targets() const noexcept {
+    return targets_;
+  }
+
+  void groups(std::vector<GroupStatistics> groups) {
+    groups_ = std::move(groups);
+  }
+
+  [[nodiscard]] const std::vector<GroupStatistics>& groups() const noexcept {
+    return groups_;
+  }
+
+  void phases(std::vector<PhaseStatistics> phases) {
+    phases_ = std::move(phases);
+  }
+
+  [[nodiscard]] const std::vector<PhaseStatistics>& phases() const noexcept {
+    return phases_;
+  }
+
+  void serverMetrics(ServerMetricsSeries series) {
+    server_metrics_ = std::move(series);
+  }
+
+  [[nodiscard]] const ServerMetricsSeries& serverMetrics() const noexcept {
+    return server_metrics_;
+  }
+
+  void captured(std::vector<CapturedTransaction> slowest,
+                std::vector<CapturedTransaction> errors) {
+    slowest_ = std::move(slowest);
+    sampled_errors_ = std::move(errors);
+  }
+
+  [[nodiscard]] const std::vector<CapturedTransaction>& slowest()
+      const noexcept {
+    return slowest_;
+  }
+
+  [[nodiscard]] const std::vector<CapturedTransaction>& sampledErrors()
+      const noexcept {
+    return sampled_errors_;
+  }
+
+  void timer(std::string source, ElapsedTimeType overhead) {
+    timer_source_ = std::move(source);
+    timer_overhead_ = overhead;
+  }
+
+  [[nodiscard]] const std::string& timerSource() const noexcept {
+    return timer_source_;
+  }
+
+  [[nodiscard]] ElapsedTimeType timerOverhead() const noexcept {
+    return timer_overhead_;
+  }
+
+  // successful transactions per second
+  [[nodiscard]] double throughput() const {
+    if (duration_.count() <= 0) {
+      return 0.0;
+    }
+    return static_cast<double>(wholeCount<kSuccessIndex>()) /
+           std::chrono::duration<double>(duration_).count();
+  }
+
   template <std::size_t Index>
-  [[nodiscard]] std::vector<std::chrono::microseconds> concat(
-      int thread_id = -1) const {
-    std::vector<std::chrono::microseconds> uss;
+  [[nodiscard]] ElapsedTimesType concat(int thread_id = -1) const {
+    ElapsedTimesType uss;
 
     if (thread_id >= 0) {
       return std::get<Index>(elapsed_times_[thread_id]);
@@ -61,12 +286,12 @@ class Statistics {
   }
 
   template <std::size_t Index>
-  [[nodiscard]] std::chrono::microseconds wholeElapsed(
+  [[nodiscard]] ElapsedTimeType wholeElapsed(
       int thread_id = -1) const {
     auto concatenated = concat<Index>(thread_id);
 
     return std::accumulate(std::begin(concatenated), std::end(concatenated),
-                           std::chrono::microseconds(0));
+                           ElapsedTimeType(0));
   }
 
   template <std::size_t Index>
@@ -75,57 +300,57 @@ class Statistics {
   }
 
   template <std::size_t Index>
-  [[nodiscard]] std::chrono::microseconds average(int thread_id = -1) const {
+  [[nodiscard]] ElapsedTimeType average(int thread_id = -1) const {
     const auto whole_elapsed = wholeElapsed<Index>(thread_id);
     const auto whole_count = wholeCount<Index>(thread_id);
     if (whole_count == 0) {
-      return std::chrono::microseconds(0);
+      return ElapsedTimeType(0);
     }
 
     return whole_elapsed / whole_count;
   }
-  [[nodiscard]] std::chrono::microseconds average(int thread_id = -1) const {
+  [[nodiscard]] ElapsedTimeType average(int thread_id = -1) const {
     const auto whole_elapsed = wholeElapsed<kSuccessIndex>(thread_id) +
                                wholeElapsed<kErrorIndex>(thread_id);
     const auto whole_count = wholeCount<kSuccessIndex>(thread_id) +
                              wholeCount<kErrorIndex>(thread_id);
     if (whole_count == 0) {
-      return std::chrono::microseconds(0);
+      return ElapsedTimeType(0);
     }
     return whole_elapsed / whole_count;
   }
 
   template <std::size_t Index>
-  [[nodiscard]] std::chrono::microseconds max(int thread_id = -1) const {
+  [[nodiscard]] ElapsedTimeType max(int thread_id = -1) const {
     auto concatenated = concat<Index>(thread_id);
     if (std::empty(concatenated)) {
-      return std::chrono::microseconds(0);
+      return ElapsedTimeType(0);
     }
 
     return *std::max_element(std::begin(concatenated), std::end(concatenated));
   }
 
   template <std::size_t Index>
-  [[nodiscard]] std::chrono::microseconds min(int thread_id = -1) const {
+  [[nodiscard]] ElapsedTimeType min(int thread_id = -1) const {
     auto concatenated = concat<Index>(thread_id);
     if (std::empty(concatenated)) {
-      return std::chrono::microseconds(0);
+      return ElapsedTimeType(0);
     }
 
     return *std::min_element(std::begin(concatenated), std::end(concatenated));
   }
 
   template <std::size_t Index>
-  [[nodiscard]] std::chrono::microseconds median(int thread_id = -1) const {
+  [[nodiscard]] ElapsedTimeType median(int thread_id = -1) const {
     auto concatenated = concat<Index>(thread_id);
     if (std::empty(concatenated)) {
-      return std::chrono::microseconds(0);
+      return ElapsedTimeType(0);
     }
     std::sort(std::begin(concatenated), std::end(concatenated));
     return concatenated[std::size(concatenated) / 2];
   }
 
-  [[nodiscard]] std::chrono::microseconds median(int thread_id = -1) const {
+  [[nodiscard]] ElapsedTimeType median(int thread_id = -1) const {
     auto concatenated = concat<kSuccessIndex>(thread_id);
     {
       auto error = concat<kErrorIndex>(thread_id);
@@ -134,12 +359,56 @@ class Statistics {
     }
 
     if (std::empty(concatenated)) {
-      return std::chrono::microseconds(0);
+      return ElapsedTimeType(0);
     }
     std::sort(std::begin(concatenated), std::end(concatenated));
     return concatenated[std::size(concatenated) / 2];
   }
 
+  template <std::size_t Index>
+  [[nodiscard]] ElapsedTimeType percentile(
+      double p, int thread_id = -1) const {
+    return PercentileOf(concat<Index>(thread_id), p);
+  }
+
+  [[nodiscard]] ElapsedTimeType percentile(
+      double p, int thread_id = -1) const {
+    auto concatenated = concat<kSuccessIndex>(thread_id);
+    {
+      auto error = concat<kErrorIndex>(thread_id);
+      concatenated.insert(std::end(concatenated), std::begin(error),
+                          std::end(error));
+    }
+    return PercentileOf(std::move(concatenated), p);
+  }
+
+  // distribution free confidence interval of a percentile by order
+  // statistics: ranks n*p -/+ z*sqrt(n*p*(1-p))
+  [[nodiscard]] std::tuple<ElapsedTimeType,
+                           ElapsedTimeType>
+  percentileInterval(double p, double z = 1.96) const {
+    auto concatenated = concat<kSuccessIndex>();
+    {
+      auto error = concat<kErrorIndex>();
+      concatenated.insert(std::end(concatenated), std::begin(error),
+                          std::end(error));
+    }
+    if (std::empty(concatenated)) {
+      return {ElapsedTimeType(0), ElapsedTimeType(0)};
+    }
+    std::sort(std::begin(concatenated), std::end(concatenated));
+
+    const auto n = static_cast<double>(std::size(concatenated));
+    const auto q = p / 100.0;
+    const auto half_width = z * std::sqrt(n * q * (1.0 - q));
+    const auto toIndex = [n](double rank) {
+      return static_cast<std::size_t>(std::clamp(std::ceil(rank), 1.0, n)) -
+             1;
+    };
+    return {concatenated[toIndex(n * q - half_width)],
+            concatenated[toIndex(n * q + half_width)]};
+  }
+
   void dump(std::ostream& os) const {
     const auto success_count = wholeCount<kSuccessIndex>();
     const auto error_count = wholeCount<kErrorIndex>();
@@ -158,15 +427,21 @@ class Statistics {
     const auto error_median = median<kErrorIndex>();
     const auto whole_median = median();
 
+    const auto success_p99 = percentile<kSuccessIndex>(99);
+    const auto error_p99 = percentile<kErrorIndex>(99);
+    const auto whole_p99 = percentile(99);
+
     os << std::dec;
     os << "name: " << name() << "\n"
        << "threads: " << threadCount() << "\n"
+       << "duration: " << duration().count() << "\n"
+       << "throughput: " << throughput() << "\n"
        << "count:\n"
        << "  whole: " << (success_count + error_count) << "\n"
        << "  success: " << success_count << "\n"
        << "  error: " << error_count << "\n"
        << "statistics:\n"
-       << "  unit: us\n"
+       << "  unit: ns\n"
        // average
        << "  average:\n"
        << "    whole: " << whole_average.count() << "\n"
@@ -189,7 +464,199 @@ class Statistics {
        << "  median:\n"
        << "    whole: " << whole_median.count() << "\n"
        << "    success: " << success_median.count() << "\n"
-       << "    error: " << error_median.count() << "\n";
+       << "    error: " << error_median.count()
+       << "\n"
+       // 99th percentile
+       << "  p99:\n"
+       << "    whole: " << whole_p99.count() << "\n"
+       << "    success: " << success_p99.count() << "\n"
+       << "    error: " << error_p99.count() << "\n";
+
+    if (!std::empty(timer_source_)) {
+      os << "timer:\n"
+         << "  source: " << timer_source_ << "\n"
+         << "  overhead: " << timer_overhead_.count() << "\n";
+    }
+
+    dumpTransactionTypes(os);
+    dumpTargets(os);
+    dumpGroups(os);
+    dumpPhases(os);
+    dumpClientUsage(os);
+    dumpConnections(os);
+  }
+
+  // intentional rollbacks are successes, they are counted apart from commits
+  void dumpTransactionTypes(std::ostream& os) const {
+    if (std::empty(transaction_types_)) {
+      return;
+    }
+
+    os << "transactions:\n";
+    for (const auto& type : transaction_types_) {
+      os << "  - {name: " << type.name << ", isolation: " << type.isolation
+         << ", read_only: " << (type.read_only ? "true" : "false")
+         << ", commit: " << type.commits << ", rollback: " << type.rollbacks
+         << ", error: " << type.errors << ", savepoint: " << type.savepoints
+         << ", savepoint_rollback: " << type.savepoint_rollbacks;
+      WriteLatencySummary(os, type.latencies, duration_);
+      os << "}\n";
+    }
+  }
+
+  void dumpTargets(std::ostream& os) const {
+    if (std::empty(targets_)) {
+      return;
+    }
+
+    os << "targets:\n";
+    for (const auto& target : targets_) {
+      os << "  - {name: " << target.name << ", role: " << target.role
+         << ", success: " << std::size(target.latencies)
+         << ", error: " << target.errors;
+      WriteLatencySummary(os, target.latencies, duration_);
+      os << "}\n";
+    }
+  }
+
+  // throughput of a group is over the time its threads ran, which is
+  // shorter than the run when it has fewer transactions than the others
+  void dumpGroups(std::ostream& os) const {
+    if (std::empty(groups_)) {
+      return;
+    }
+
+    os << "groups:\n";
+    for (const auto& group : groups_) {
+      os << "  - {name: " << group.name << ", threads: " << group.threads
+         << ", success: " << std::size(group.latencies)
+         << ", error: " << group.errors;
+      WriteLatencySummary(
+          os, group.latencies,
+          group.duration.count() > 0 ? group.duration : duration_, true);
+      os << "}\n";
+    }
+  }
+
+  // a spike shows in its own phase, recovery from it in the following one
+  void dumpPhases(std::ostream& os) const {
+    if (std::empty(phases_)) {
+      return;
+    }
+
+    os << "phases:\n";
+    for (const auto& phase : phases_) {
+      os << "  - {name: " << phase.name << ", start: " << phase.start.count()
+         << ", duration: " << phase.duration.count()
+         << ", success: " << std::size(phase.latencies)
+         << ", error: " << phase.errors;
+      WriteLatencySummary(os, phase.latencies, phase.duration, true);
+      os << "}\n";
+    }
+  }
+
+  void dumpConnections(std::ostream& os) const {
+    if (std::empty(connections_.connect) && connections_.errors == 0) {
+      return;
+    }
+
+    const auto dumpTimes = [&os](const char* name,
+                                 const ElapsedTimesType& times) {
+      const auto sum = std::accumulate(std::begin(times), std::end(times),
+                                       ElapsedTimeType(0));
+      os << "  " << name << ":\n"
+         << "    average: "
+         << (std::empty(times) ? 0 : (sum / std::size(times)).count()) << "\n"
+         << "    median: " << PercentileOf(times, 50).count() << "\n"
+         << "    p90: " << PercentileOf(times, 90).count() << "\n"
+         << "    p99: " << PercentileOf(times, 99).count() << "\n"
+         << "    max: " << PercentileOf(times, 100).count() << "\n";
+    };
+
+    os << "connections:\n"
+       << "  unit: ns\n"
+       << "  count: " << std::size(connections_.connect) << "\n"
+       << "  error: " << connections_.errors << "\n";
+    dumpTimes("connect", connections_.connect);
+    dumpTimes("first_transaction", connections_.first_transaction);
+  }
+
+  // above this share of a core the client itself may limit throughput
+  inline static constexpr double kSaturatedUtilization = 0.9;
+
+  void dumpClientUsage(std::ostream& os) const {
+    if (std::empty(client_usages_) || duration_.count() <= 0) {
+      return;
+    }
+
+    // cpu time is measured in microseconds
+    const auto duration_us = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::microseconds>(duration_)
+            .count());
+
+    ClientUsage whole;
+    double max_utilization = 0.0;
+    bool has_perf = true;
+    ClientUsage::Perf perf{0, 0, 0};
+    for (const auto& usage : client_usages_) {
+      whole.cpu_time += usage.cpu_time;
+      whole.generation += usage.generation;
+      whole.driver += usage.driver;
+      whole.wait += usage.wait;
+      whole.voluntary_switches += usage.voluntary_switches;
+      whole.involuntary_switches += usage.involuntary_switches;
+      max_utilization = std::max(
+          max_utilization, static_cast<double>(usage.cpu_time.count()) /
+                               duration_us);
+      if (usage.perf) {
+        perf.cycles += usage.perf->cycles;
+        perf.instructions += usage.perf->instructions;
+        perf.cache_misses += usage.perf->cache_misses;
+      } else {
+        has_perf = false;
+      }
+    }
+
+    const auto threads = static_cast<double>(std::size(client_usages_));
+    const auto average_utilization =
+        static_cast<double>(whole.cpu_time.count()) /
+        (duration_us * threads);
+    const auto cores =
+        static_cast<double>(std::max(1u, std::thread::hardware_concurrency()));
+    const auto process_utilization =
+        static_cast<double>(whole.cpu_time.count()) /
+        (duration_us * cores);
+
+    os << "client:\n"
+       << "  unit: us\n"
+       << "  cpu_time: " << whole.cpu_time.count() << "\n"
+       << "  utilization:\n"
+       << "    average: " << average_utilization << "\n"
+       << "    max: " << max_utilization << "\n"
+       << "    cores: " << process_utilization << "\n"
+       << "  time:\n"
+       << "    generation: " << whole.generation.count() << "\n"
+       << "    driver: " << whole.driver.count() << "\n"
+       << "    wait: " << whole.wait.count() << "\n"
+       << "  context_switches:\n"
+       << "    voluntary: " << whole.voluntary_switches << "\n"
+       << "    involuntary: " << whole.involuntary_switches << "\n";
+    if (has_perf) {
+      os << "  perf:\n"
+         << "    cycles: " << perf.cycles << "\n"
+         << "    instructions: " << perf.instructions << "\n"
+         << "    ipc: "
+         << (perf.cycles == 0 ? 0.0
+                              : static_cast<double>(perf.instructions) /
+                                    static_cast<double>(perf.cycles))
+         << "\n"
+         << "    cache_misses: " << perf.cache_misses << "\n";
+    }
+    if (max_utilization >= kSaturatedUtilization ||
+        process_utilization >= kSaturatedUtilization) {
+      os << "  warning: client cpu is near saturation, results may be "
+            "limited by tx-bench\n";
+    }
   }
 
   [[nodiscard]] std::string dump() const {
@@ -199,12 +666,12 @@ class Statistics {
   }
 
   using Histogram =
-      std::vector<std::tuple<std::chrono::microseconds, std::size_t>>;
+      std::vector<std::tuple<ElapsedTimeType, std::size_t>>;
 
   void dumpHistogram(std::size_t rank_margin, std::ostream& os) const {
     auto success_histogram = histogram<kSuccessIndex>(rank_margin);
 
-    os << "elapsed time(us),count\n";
+    os << "elapsed time(ns),count\n";
     for (const auto& h : success_histogram) {
       os << std::get<0>(h).count() << "," << std::get<1>(h) << "\n";
     }
@@ -212,24 +679,143 @@ class Statistics {
 
   void dumpAllElapsed(std::ostream& os) {}
 
+  // client and server side of every sampling interval as csv, so a latency
+  // spike lines up with a checkpoint or a burst of lock waits
+  void dumpServerMetrics(std::ostream& os) const {
+    // counters of bytes do not fit the default precision
+    os << std::dec << std::setprecision(15);
+    os << "time(ns),success,error,average(us),p99(us)";
+    for (const auto& name : server_metrics_.names) {
+      os << "," << name;
+    }
+    os << "\n";
+    for (const auto& sample : server_metrics_.samples) {
+      os << sample.time.count() << "," << sample.success << ","
+         << sample.errors << "," << sample.average << "," << sample.p99;
+      for (std::size_t i = 0; i < std::size(server_metrics_.names); ++i) {
+        os << ",";
+        if (i < std::size(sample.server) && sample.server[i]) {
+          os << *sample.server[i];
+        }
+      }
+      os << "\n";
+    }
+  }
+
+  // captured transactions, written to a report of their own since the
+  // statements can be long
+  void dumpCaptured(std::ostream& os) const {
+    os << std::dec;
+    os << "name: " << name_ << "\n"
+       << "unit: ns\n";
+    const auto dump = [&os](const char* key,
+                            const std::vector<CapturedTransaction>& entries) {
+      os << key << ":" << (std::empty(entries) ? " []" : "") << "\n";
+      for (const auto& entry : entries) {
+        os << "  - type: " << entry.type << "\n"
+           << "    thread: " << entry.thread << "\n"
+           << "    start: " << entry.start.count() << "\n"
+           << "    latency: " << entry.latency.count() << "\n";
+        if (!std::empty(entry.error)) {
+          os << "    error: " << Quote(entry.error) << "\n";
+        }
+        os << "    statements:\n";
+        for (std::size_t i = 0; i < std::size(entry.statements); ++i) {
+          os << "      - {elapsed: ";
+          if (i < std::size(entry.timings)) {
+            os << entry.timings[i].count();
+          } else {
+            os << "null";  // not sent
+          }
+          os << ", sql: " << Quote(entry.statements[i]) << "}\n";
+        }
+      }
+    };
+    dump("slowest", slowest_);
+    dump("errors", sampled_errors_);
+  }
+
  private:
+  static std::string Quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (const auto c : text) {
+      switch (c) {
+        case '"':
+        case '\\':
+          quoted += '\\';
+          quoted += c;
+          break;
+        case '\n':
+          quoted += "\\n";
+          break;
+        case '\t':
+          quoted += "\\t";
+          break;
+        case '\r':
+          quoted += "\\r";
+          break;
+        default:
+          quoted += c;
+      }
+    }
+    return quoted + "\"";
+  }
+
+  // throughput over duration, average and p99 of latencies as fields of a
+  // flow mapping, with median and max as well for spread
+  static void WriteLatencySummary(std::ostream& os,
+                                  const ElapsedTimesType& latencies,
+                                  ElapsedTimeType duration,
+                                  bool spread = false) {
+    const auto count = std::size(latencies);
+    const auto sum = std::accumulate(std::begin(latencies),
+                                     std::end(latencies), ElapsedTimeType(0));
+    const auto throughput =
+        duration.count() <= 0
+            ? 0.0
+            : static_cast<double>(count) /
+                  std::chrono::duration<double>(duration).count();
+    os << ", throughput: " << throughput
+       << ", average: " << (count == 0 ? 0 : (sum / count).count());
+    if (spread) {
+      os << ", median: " << PercentileOf(latencies, 50).count();
+    }
+    os << ", p99: " << PercentileOf(latencies, 99).count();
+    if (spread) {
+      os << ", max: " << PercentileOf(latencies, 100).count();
+    }
+  }
+
+  static ElapsedTimeType PercentileOf(ElapsedTimesType values,
+                                                double p) {
+    if (std::empty(values)) {
+      return ElapsedTimeType(0);
+    }
+    const auto size = std::size(values);
+    auto rank = static_cast<std::size_t>(
+        std::ceil(p / 100.0 * static_cast<double>(size)));
+    rank = std::clamp<std::size_t>(rank, 1, size) - 1;
+    std::nth_element(std::begin(values), std::begin(values) + rank,
+                     std::end(values));
+    return values[rank];
+  }
+
   template <std::size_t Which>
   static Histogram CreateHistogramImpl(
       std::size_t rank_margin,
       const std::vector<ElapsedTImesPerThreadType>& ept,
-      std::chrono::microseconds min, std::chrono::microseconds max) {
-    std::map<std::chrono::microseconds, std::size_t> counter;
+      ElapsedTimeType min, ElapsedTimeType max) {
+    std::map<ElapsedTimeType, std::size_t> counter;
 
-    const auto toRank = [rank_margin](const std::chrono::microseconds& us) {
-      return std::chrono::microseconds((us.count() / rank_margin) *
-                                       rank_margin);
+    const auto toRank = [rank_margin](const ElapsedTimeType& ns) {
+      return ElapsedTimeType((ns.count() / rank_margin) * rank_margin);
     };
 
     min = toRank(min);
     max = toRank(max);
 
-    for (std::chrono::microseconds cv = min; cv < max;
-         cv += std::chrono::microseconds(rank_margin)) {
+    for (ElapsedTimeType cv = min; cv < max;
+         cv += ElapsedTimeType(rank_margin)) {
       counter[cv] = 0;
     }
 
@@ -242,7 +828,7 @@ class Statistics {
     Histogram hist(std::size(counter));
     std::transform(
         std::begin(counter), std::end(counter), std::begin(hist),
-        [](const std::pair<std::chrono::microseconds, std::size_t>& c) {
+        [](const std::pair<ElapsedTimeType, std::size_t>& c) {
           return c;
         });
 
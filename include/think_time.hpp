@@ -0,0 +1,128 @@
+#pragma once
+
+#include <yaml-cpp/yaml.h>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace tb {
+
+// pause before (keying time) or after (think time) a transaction.
+// all values are in microseconds.
+class ThinkTime {
+ public:
+  enum class Distribution {
+    kNone,
+    kFixed,
+    kUniform,
+    kExponential,
+    // exponential truncated at max, as TPC-C specifies (max = 10 * mean)
+    kNegativeExponential,
+  };
+
+ private:
+  Distribution distribution_ = Distribution::kNone;
+  std::chrono::microseconds min_{0}, max_{0}, mean_{0};
+
+ public:
+  ThinkTime() = default;
+
+  static ThinkTime Fixed(std::chrono::microseconds value) {
+    ThinkTime think_time;
+    think_time.distribution_ = Distribution::kFixed;
+    think_time.mean_ = value;
+    return think_time;
+  }
+
+  // scalar: fixed time, map: {distribution: ..., min/max/mean: ...}
+  static ThinkTime Make(const YAML::Node& node) {
+    if (node.IsScalar()) {
+      return Fixed(std::chrono::microseconds(node.as<long>()));
+    }
+
+    const auto get = [&node](const char* key) {
+      if (!node[key]) {
+        throw std::runtime_error(std::string("think time requires ") + key);
+      }
+      return std::chrono::microseconds(node[key].as<long>());
+    };
+
+    ThinkTime think_time;
+    const auto distribution = node["distribution"].as<std::string>("fixed");
+    if (distribution == "fixed") {
+      think_time = Fixed(get("value"));
+    } else if (distribution == "uniform") {
+      think_time.distribution_ = Distribution::kUniform;
+      think_time.min_ = get("min");
+      think_time.max_ = get("max");
+    } else if (distribution == "exponential") {
+      think_time.distribution_ = Distribution::kExponential;
+      think_time.mean_ = get("mean");
+    } else if (distribution == "negative_exponential") {
+      think_time.distribution_ = Distribution::kNegativeExponential;
+      think_time.mean_ = get("mean");
+      think_time.max_ = node["max"] ? get("max") : think_time.mean_ * 10;
+    } else {
+      throw std::runtime_error("unknown think time distribution " +
+                               distribution);
+    }
+
+    if (think_time.min_.count() < 0 || think_time.max_ < think_time.min_ ||
+        think_time.mean_.count() < 0) {
+      throw std::runtime_error("invalid think time range");
+    }
+    return think_time;
+  }
+
+ public:
+  [[nodiscard]] bool enabled() const noexcept {
+    return distribution_ != Distribution::kNone;
+  }
+
+  template <class Rng>
+  [[nodiscard]] std::chrono::microseconds sample(Rng& rng) const {
+    using std::chrono::microseconds;
+    switch (distribution_) {
+      case Distribution::kNone:
+        return microseconds(0);
+      case Distribution::kFixed:
+        return mean_;
+      case Distribution::kUniform:
+        return microseconds(std::uniform_int_distribution<long>(
+            min_.count(), max_.count())(rng));
+      case Distribution::kExponential:
+      case Distribution::kNegativeExponential: {
+        if (mean_.count() == 0) {
+          return microseconds(0);
+        }
+        const auto value = std::exponential_distribution<double>(
+            1.0 / static_cast<double>(mean_.count()))(rng);
+        const auto us = microseconds(std::llround(value));
+        if (distribution_ == Distribution::kNegativeExponential) {
+          return std::min(us, max_);
+        }
+        return us;
+      }
+    }
+    return microseconds(0);
+  }
+
+  // sleeps for a sampled time and returns it
+  template <class Rng>
+  std::chrono::microseconds pause(Rng& rng) const {
+    if (!enabled()) {
+      return std::chrono::microseconds(0);
+    }
+    const auto us = sample(rng);
+    if (us.count() > 0) {
+      std::this_thread::sleep_for(us);
+    }
+    return us;
+  }
+};
+
+}  // namespace tb
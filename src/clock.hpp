@@ -0,0 +1,133 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TB_HAS_TSC 1
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <thread>
+
+namespace tb {
+
+// monotonic nanosecond clock for latencies. it reads steady_clock unless
+// the time stamp counter is selected, which is used only when the cpu
+// reports it invariant (constant rate, not stopped in sleep states) and
+// after it was calibrated against steady_clock.
+class Clock {
+ public:
+  using rep = std::int64_t;
+  using period = std::nano;
+  using duration = std::chrono::nanoseconds;
+  using time_point = std::chrono::time_point<Clock>;
+  inline static constexpr bool is_steady = true;
+
+  enum class Source {
+    kSteady,
+    kTsc,
+  };
+
+ private:
+  struct State {
+    Source source;
+    // steady_clock time and counter value at calibration
+    std::int64_t base_ns;
+    std::uint64_t base_ticks;
+    double ns_per_tick;
+  };
+
+  inline static State state_ = {Source::kSteady, 0, 0, 0.0};
+
+ public:
+  static time_point now() noexcept {
+#ifdef TB_HAS_TSC
+    if (state_.source == Source::kTsc) {
+      // signed, another core may read a counter slightly behind the base
+      const auto ticks = static_cast<std::int64_t>(__rdtsc()) -
+                         static_cast<std::int64_t>(state_.base_ticks);
+      return time_point(duration(
+          state_.base_ns +
+          static_cast<std::int64_t>(static_cast<double>(ticks) *
+                                    state_.ns_per_tick)));
+    }
+#endif
+    return time_point(std::chrono::duration_cast<duration>(
+        std::chrono::steady_clock::now().time_since_epoch()));
+  }
+
+  // selects the source before workers start, false when the time stamp
+  // counter was requested but is not usable (steady_clock is kept then)
+  static bool Use(Source source) {
+    if (source == Source::kSteady) {
+      state_ = {Source::kSteady, 0, 0, 0.0};
+      return true;
+    }
+#ifdef TB_HAS_TSC
+    if (!HasInvariantTsc()) {
+      return false;
+    }
+    state_ = Calibrate();
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  [[nodiscard]] static Source source() noexcept { return state_.source; }
+
+  static std::string_view ToString(Source source) {
+    return source == Source::kTsc ? "tsc" : "steady";
+  }
+
+  // average cost of one now(), measured with the current source
+  static duration Overhead() {
+    constexpr int kSamples = 100000;
+    const auto begin = now();
+    for (int i = 0; i < kSamples; ++i) {
+      static_cast<void>(now());
+    }
+    return (now() - begin) / kSamples;
+  }
+
+ private:
+#ifdef TB_HAS_TSC
+  // CPUID.80000007H:EDX[8]
+  static bool HasInvariantTsc() {
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007 ||
+        !__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+      return false;
+    }
+    return (edx & (1u << 8)) != 0;
+  }
+
+  // counts ticks over a short steady_clock interval
+  static State Calibrate() {
+    using Steady = std::chrono::steady_clock;
+    constexpr auto kInterval = std::chrono::milliseconds(50);
+
+    const auto steady_begin = Steady::now();
+    const auto ticks_begin = __rdtsc();
+    std::this_thread::sleep_for(kInterval);
+    const auto steady_end = Steady::now();
+    const auto ticks_end = __rdtsc();
+
+    const auto elapsed =
+        std::chrono::duration_cast<duration>(steady_end - steady_begin);
+    State state{};
+    state.source = Source::kTsc;
+    state.base_ns = std::chrono::duration_cast<duration>(
+                        steady_end.time_since_epoch())
+                        .count();
+    state.base_ticks = ticks_end;
+    state.ns_per_tick = static_cast<double>(elapsed.count()) /
+                        static_cast<double>(ticks_end - ticks_begin);
+    return state;
+  }
+#endif
+};
+
+}  // namespace tb
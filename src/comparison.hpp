@@ -0,0 +1,186 @@
+#pragma once
+
+#include <yaml-cpp/yaml.h>
+
+#include <chrono>
+#include <configuration.hpp>
+#include <iomanip>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <statistics.hpp>
+#include <string>
+#include <vector>
+
+namespace tb {
+
+// headline numbers of one result, from a run or a dumped result file
+struct ResultSummary {
+  std::string label;
+  double throughput = 0.0;
+  Statistics::ElapsedTimeType average{0}, median{0}, p99{0}, max{0};
+  std::size_t success = 0, error = 0;
+
+  static ResultSummary Of(std::string label, const Statistics& statistics) {
+    using Index = Statistics;
+    ResultSummary summary;
+    summary.label = std::move(label);
+    summary.throughput = statistics.throughput();
+    summary.average = statistics.average<Index::kSuccessIndex>();
+    summary.median = statistics.median<Index::kSuccessIndex>();
+    summary.p99 = statistics.percentile<Index::kSuccessIndex>(99);
+    summary.max = statistics.max<Index::kSuccessIndex>();
+    summary.success = statistics.wholeCount<Index::kSuccessIndex>();
+    summary.error = statistics.wholeCount<Index::kErrorIndex>();
+    return summary;
+  }
+
+  // result written by Statistics::dump
+  static ResultSummary Load(const std::string& path) {
+    const auto node = YAML::LoadFile(path);
+    if (!node["statistics"] || !node["count"]) {
+      throw std::runtime_error(path + " is not a result file");
+    }
+
+    // results written before the nanosecond clock are in microseconds
+    const auto scale = node["statistics"]["unit"].as<std::string>("ns") == "us"
+                           ? 1000
+                           : 1;
+    const auto latency = [&node, scale](const char* key) {
+      return Statistics::ElapsedTimeType(
+          node["statistics"][key]["success"].as<long>(0) * scale);
+    };
+
+    ResultSummary summary;
+    summary.label = path;
+    summary.average = latency("average");
+    summary.median = latency("median");
+    summary.p99 = latency("p99");
+    summary.max = latency("max");
+    summary.success = node["count"]["success"].as<std::size_t>(0);
+    summary.error = node["count"]["error"].as<std::size_t>(0);
+    summary.throughput = node["throughput"].as<double>(0.0);
+    return summary;
+  }
+};
+
+// side by side table of results against the first one (the baseline)
+class Comparison {
+ private:
+  struct Metric {
+    const char* name;
+    double (*get)(const ResultSummary&);
+    std::optional<double> RegressionThresholds::*threshold;
+    bool higher_is_better;
+  };
+
+  inline static constexpr Metric kMetrics[] = {
+      {"throughput", [](const ResultSummary& r) { return r.throughput; },
+       &RegressionThresholds::throughput, true},
+      {"average",
+       [](const ResultSummary& r) {
+         return static_cast<double>(r.average.count());
+       },
+       &RegressionThresholds::average, false},
+      {"median",
+       [](const ResultSummary& r) {
+         return static_cast<double>(r.median.count());
+       },
+       &RegressionThresholds::median, false},
+      {"p99",
+       [](const ResultSummary& r) {
+         return static_cast<double>(r.p99.count());
+       },
+       &RegressionThresholds::p99, false},
+      {"max",
+       [](const ResultSummary& r) {
+         return static_cast<double>(r.max.count());
+       },
+       &RegressionThresholds::max, false},
+  };
+
+  std::vector<ResultSummary> results_;
+  RegressionThresholds thresholds_;
+
+ public:
+  Comparison(ResultSummary baseline, const RegressionThresholds& thresholds)
+      : results_{std::move(baseline)}, thresholds_(thresholds) {}
+
+ public:
+  void add(ResultSummary result) { results_.emplace_back(std::move(result)); }
+
+  // true when any result crosses a threshold in the worse direction
+  [[nodiscard]] bool regressed() const {
+    for (std::size_t r = 1; r < std::size(results_); ++r) {
+      for (const auto& metric : kMetrics) {
+        if (isRegression(metric, results_[r])) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // latencies in nanoseconds, deltas relative to the baseline
+  void print(std::ostream& os) const {
+    constexpr int kMetricWidth = 12, kValueWidth = 24;
+
+    os << std::left << std::setw(kMetricWidth) << "metric";
+    for (const auto& result : results_) {
+      os << std::setw(kValueWidth) << Shorten(result.label, kValueWidth - 1);
+    }
+    os << "\n";
+
+    for (const auto& metric : kMetrics) {
+      os << std::setw(kMetricWidth) << metric.name;
+      const auto base = metric.get(results_.front());
+      for (std::size_t r = 0; r < std::size(results_); ++r) {
+        std::ostringstream cell;
+        cell << std::fixed << std::setprecision(1) << metric.get(results_[r]);
+        if (r > 0) {
+          cell << " (" << std::showpos
+               << Delta(base, metric.get(results_[r])) * 100.0
+               << std::noshowpos << "%)";
+          if (isRegression(metric, results_[r])) {
+            cell << " !";
+          }
+        }
+        os << std::setw(kValueWidth) << cell.str();
+      }
+      os << "\n";
+    }
+    os << std::right;
+
+    if (regressed()) {
+      os << "regression: a threshold was crossed (marked with !)\n";
+    }
+  }
+
+ private:
+  [[nodiscard]] bool isRegression(const Metric& metric,
+                                  const ResultSummary& result) const {
+    const auto& threshold = thresholds_.*(metric.threshold);
+    if (!threshold) {
+      return false;
+    }
+    const auto delta =
+        Delta(metric.get(results_.front()), metric.get(result));
+    return metric.higher_is_better ? -delta > *threshold : delta > *threshold;
+  }
+
+  static double Delta(double base, double value) {
+    if (base == 0.0) {
+      return 0.0;
+    }
+    return (value - base) / base;
+  }
+
+  static std::string Shorten(const std::string& label, std::size_t width) {
+    if (std::size(label) <= width) {
+      return label;
+    }
+    return "..." + label.substr(std::size(label) - (width - 3));
+  }
+};
+
+}  // namespace tb
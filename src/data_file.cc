@@ -0,0 +1,122 @@
+#include "data_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+std::mutex registry_mutex;
+std::unordered_map<std::string, std::unique_ptr<tb::DataFile>> registry;
+
+}  // namespace
+
+namespace tb {
+
+DataFile::DataFile(const std::string& path, char delimiter, bool has_header)
+    : delimiter_(delimiter), cursor_(0) {
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open data file " + path);
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("cannot stat data file " + path);
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+  if (size_ == 0) {
+    ::close(fd);
+    throw std::runtime_error("data file is empty " + path);
+  }
+
+  auto mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("cannot map data file " + path);
+  }
+  data_ = static_cast<const char*>(mapped);
+  ::madvise(mapped, size_, MADV_WILLNEED);
+
+  std::size_t offset = 0;
+  while (offset < size_) {
+    const auto newline = static_cast<const char*>(
+        std::memchr(data_ + offset, '\n', size_ - offset));
+    const auto end =
+        newline ? static_cast<std::size_t>(newline - data_) : size_;
+    if (end > offset) {
+      line_offsets_.emplace_back(offset);
+    }
+    offset = end + 1;
+  }
+  if (has_header && !std::empty(line_offsets_)) {
+    line_offsets_.erase(std::begin(line_offsets_));
+  }
+  if (std::empty(line_offsets_)) {
+    // the destructor does not run for a throwing constructor
+    ::munmap(mapped, size_);
+    throw std::runtime_error("data file has no line " + path);
+  }
+
+  // the index is all that is needed for random access
+  ::madvise(mapped, size_, MADV_RANDOM);
+}
+
+DataFile::~DataFile() {
+  if (data_) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+void DataFile::Load(const std::string& name, const std::string& path,
+                    char delimiter, bool has_header) {
+  auto file = std::make_unique<DataFile>(path, delimiter, has_header);
+  std::lock_guard lg(registry_mutex);
+  registry[name] = std::move(file);
+}
+
+// files are loaded at startup, lookups from workers do not need the lock
+const DataFile& DataFile::Get(const std::string& name) {
+  const auto itr = registry.find(name);
+  if (itr == std::end(registry)) {
+    throw std::runtime_error("unknown data file " + name);
+  }
+  return *itr->second;
+}
+
+std::string_view DataFile::line(std::size_t index) const {
+  const auto begin = line_offsets_.at(index);
+  const auto newline = static_cast<const char*>(
+      std::memchr(data_ + begin, '\n', size_ - begin));
+  auto end = newline ? static_cast<std::size_t>(newline - data_) : size_;
+  if (end > begin && data_[end - 1] == '\r') {
+    --end;
+  }
+  return {data_ + begin, end - begin};
+}
+
+std::string_view DataFile::column(std::size_t index, std::size_t column) const {
+  auto rest = line(index);
+  for (std::size_t i = 0; i < column; ++i) {
+    const auto pos = rest.find(delimiter_);
+    if (pos == std::string_view::npos) {
+      throw std::runtime_error("data file column out of range");
+    }
+    rest.remove_prefix(pos + 1);
+  }
+
+  auto value = rest.substr(0, rest.find(delimiter_));
+  if (std::size(value) >= 2 && value.front() == '"' && value.back() == '"') {
+    value = value.substr(1, std::size(value) - 2);
+  }
+  return value;
+}
+
+}  // namespace tb
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tb {
+
+// read only memory mapped CSV or newline delimited file.
+// lines are indexed once, values are returned as views into the mapping.
+// as views cannot be unescaped, only the quotes around a value are removed:
+// a quoted value must not contain the delimiter, a newline or "" escapes.
+class DataFile {
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  char delimiter_;
+  std::vector<std::uint64_t> line_offsets_;
+  mutable std::atomic<std::size_t> cursor_;
+
+ public:
+  DataFile(const std::string& path, char delimiter, bool has_header);
+
+  DataFile(const DataFile&) = delete;
+  DataFile(DataFile&&) = delete;
+
+  DataFile& operator=(const DataFile&) = delete;
+  DataFile& operator=(DataFile&&) = delete;
+
+  ~DataFile();
+
+ public:
+  // registers a file under name, loaded files are shared by all threads
+  static void Load(const std::string& name, const std::string& path,
+                   char delimiter = ',', bool has_header = false);
+  static const DataFile& Get(const std::string& name);
+
+ public:
+  [[nodiscard]] std::size_t lines() const noexcept {
+    return std::size(line_offsets_);
+  }
+
+  [[nodiscard]] std::string_view line(std::size_t index) const;
+  [[nodiscard]] std::string_view column(std::size_t index,
+                                        std::size_t column) const;
+
+  // index of the next line shared by all threads, wraps around
+  std::size_t next() const noexcept {
+    return cursor_.fetch_add(1, std::memory_order_relaxed) % lines();
+  }
+};
+
+}  // namespace tb
@@ -4,17 +4,33 @@
 
 #pragma once
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <atomic>
 #include <chrono>
 #include <configuration.hpp>
 #include <database.hpp>
 #include <future>
+#include <iostream>
 #include <properties.hpp>
 #include <shared_mutex>
 #include <statistics.hpp>
+#include <thread>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+#include "clock.hpp"
+#include "live_metrics.hpp"
+#include "load_profile.hpp"
+#include "rate_limiter.hpp"
+#include "resource_usage.hpp"
+#include "router.hpp"
+#include "server_sampler.hpp"
+#include "shared_results.hpp"
+#include "transaction_capture.hpp"
+
 #define tb_likely(x) __builtin_expect(!!(x), 1)
 
 namespace tb {
@@ -25,12 +41,28 @@ class Executor {
   std::atomic<std::size_t> thread_counter_;
   std::function<std::unique_ptr<database::Database>(const Properties&)>
       create_database_;
+  // connections are kept open between execute() calls, one per thread slot
+  // and target
+  std::vector<std::vector<std::unique_ptr<database::Database>>> connections_;
+  LiveMetrics metrics_;
+  // index of this worker process, 0 when not forked
+  std::size_t process_index_ = 0;
+  // called once every thread is connected, before the clock starts
+  std::function<void()> start_gate_;
+  // when the threads were released, captured transactions start from it
+  Clock::time_point run_start_;
 
  private:
   class InternalStat {
    private:
-    std::vector<std::chrono::microseconds> error_elapsed_times_;
-    std::vector<std::chrono::microseconds> elapsed_times_;
+    std::vector<Statistics::ElapsedTimeType> error_elapsed_times_;
+    std::vector<Statistics::ElapsedTimeType> elapsed_times_;
+    ClientUsage usage_;
+    ConnectionTimes connections_;
+    std::vector<TransactionTypeStatistics> types_;
+    std::vector<TargetStatistics> targets_;
+    std::vector<PhaseStatistics> phases_;
+    TransactionCapture capture_;
 
    public:
     InternalStat() = default;
@@ -44,22 +76,28 @@ class Executor {
     template <class TimePoint>
     void addElapsed(const TimePoint& begin, const TimePoint& end) {
       addElapsed(
-          std::chrono::duration_cast<std::chrono::microseconds>(end - begin));
+          std::chrono::duration_cast<Statistics::ElapsedTimeType>(end - begin));
     }
 
-    void addElapsed(std::chrono::microseconds us) {
-      elapsed_times_.emplace_back(us);
+    void addElapsed(Statistics::ElapsedTimeType elapsed) {
+      elapsed_times_.emplace_back(elapsed);
     }
 
    public:
     template <class TimePoint>
     void addError(const TimePoint& begin, const TimePoint& end) {
       addError(
-          std::chrono::duration_cast<std::chrono::microseconds>(end - begin));
+          std::chrono::duration_cast<Statistics::ElapsedTimeType>(end - begin));
+    }
+
+    void addError(Statistics::ElapsedTimeType elapsed) {
+      error_elapsed_times_.emplace_back(elapsed);
     }
 
-    void addError(std::chrono::microseconds us) {
-      error_elapsed_times_.emplace_back(us);
+    // the last success was rolled back with its batch afterwards
+    void discardElapsed() {
+      error_elapsed_times_.emplace_back(elapsed_times_.back());
+      elapsed_times_.pop_back();
     }
 
    public:
@@ -73,6 +111,50 @@ class Executor {
       }
     }
 
+    template <class TimePoint, class Duration>
+    void addEntry(bool is_success, const TimePoint& begin, const TimePoint& end,
+                  const Duration& delay) {
+      const auto elapsed =
+          std::chrono::duration_cast<Statistics::ElapsedTimeType>(end - begin) +
+          std::chrono::duration_cast<Statistics::ElapsedTimeType>(delay);
+      if (tb_likely(is_success)) {
+        addElapsed(elapsed);
+      } else {
+        addError(elapsed);
+      }
+    }
+
+   public:
+    ClientUsage& usage() noexcept { return usage_; }
+    [[nodiscard]] const ClientUsage& usage() const noexcept { return usage_; }
+
+    std::vector<TransactionTypeStatistics>& transactionTypes() noexcept {
+      return types_;
+    }
+    [[nodiscard]] const std::vector<TransactionTypeStatistics>&
+    transactionTypes() const noexcept {
+      return types_;
+    }
+
+    std::vector<TargetStatistics>& targets() noexcept { return targets_; }
+    [[nodiscard]] const std::vector<TargetStatistics>& targets()
+        const noexcept {
+      return targets_;
+    }
+
+    std::vector<PhaseStatistics>& phases() noexcept { return phases_; }
+    [[nodiscard]] const std::vector<PhaseStatistics>& phases()
+        const noexcept {
+      return phases_;
+    }
+
+    TransactionCapture& capture() noexcept { return capture_; }
+
+    ConnectionTimes& connections() noexcept { return connections_; }
+    [[nodiscard]] const ConnectionTimes& connections() const noexcept {
+      return connections_;
+    }
+
    public:
     [[nodiscard]] Statistics::ElapsedTImesPerThreadType toStatisticsElement()
         const {
@@ -91,74 +173,571 @@ class Executor {
     return create_database_(props);
   }
 
+  // counters of the running benchmark, safe to read from any thread
+  [[nodiscard]] const LiveMetrics& metrics() const noexcept {
+    return metrics_;
+  }
+
  private:
   InternalStat executeImpl(const tb::Configuration& config,
-                           const Properties& props) {
-    auto transactions = config.createQueries();
-    std::unique_ptr<database::Database> db;
-    try {
-      db = create(props);
-    } catch (const std::exception& e) {
-      std::cerr << "error: " << e.what() << std::endl;
-      return InternalStat();
+                           const Router& router, std::size_t thread_id) {
+    // worker ids and the rate are over the threads of all processes
+    const auto workers = config.threadCount() * config.processes();
+    te::CurrentWorker().reset(
+        process_index_ * config.threadCount() + thread_id, workers,
+        config.seed());
+    // a thread of a group runs its transactions at its rate
+    const auto* group = config.group(thread_id);
+    const auto count = group ? group->count : config.count();
+    TransactionGenerator generator(config, group);
+    // with reconnect_every every connection is made and timed in the loop
+    const auto reconnect_every = config.reconnectEvery();
+    const auto& targets = router.targets();
+    auto& dbs = connections_[thread_id];
+    dbs.resize(std::size(targets));
+    if (reconnect_every == 0) {
+      try {
+        for (std::size_t t = 0; t < std::size(targets); ++t) {
+          if (!dbs[t]) {
+            dbs[t] = create(targets[t].properties);
+          }
+        }
+      } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        thread_counter_++;  // do not keep the others at the start gate
+        return InternalStat();
+      }
+    }
+    InternalStat stat(count);
+    stat.transactionTypes() = TransactionTypes(config);
+    for (auto& type : stat.transactionTypes()) {
+      type.latencies.reserve(count);
+    }
+    stat.targets() = router.statistics();
+    const LoadProfile profile(config);
+    stat.phases() = profile.statistics();
+    const auto capturing = config.capture().enabled();
+    stat.capture() = TransactionCapture(config.capture());
+
+    RateLimiter limiter(
+        group ? group->rate / static_cast<double>(group->threads *
+                                                  config.processes())
+              : config.rate() / static_cast<double>(workers));
+
+    PerfCounters perf_counters;
+    const auto use_perf = config.perfCounters() && perf_counters.open();
+    if (config.perfCounters() && !use_perf && thread_id == 0) {
+      std::cerr << "warning: perf counters are not available" << std::endl;
     }
-    InternalStat stat(config.count());
 
     thread_counter_++;
-    shared_mutex_.lock_shared();  // block
+    { std::shared_lock<std::shared_mutex> start(shared_mutex_); }  // block
+
+    TransactionController controller(config);
+    controller.timeStatements(capturing, MaxStatements(config));
+    auto& capture = stat.capture();
+    const auto worker = process_index_ * config.threadCount() + thread_id;
+    std::string error_message;
+    auto& types = stat.transactionTypes();
+    auto& target_stats = stat.targets();
+    auto& phase_stats = stat.phases();
+    Router::Cursor cursor;
+    // target of the previous transaction, a batch does not span targets
+    std::optional<std::size_t> last_target;
+    // type and phase of the successes in the open batch, the latest of
+    // their kind. when the batch fails they become errors, when
+    // rollback_ratio rolls it back they become rollbacks.
+    std::vector<std::pair<std::size_t, std::size_t>> uncommitted;
+    const auto discard = [&](std::size_t discarded, std::size_t target,
+                             bool rolled_back = false) {
+      for (; discarded > 0 && !std::empty(uncommitted); --discarded) {
+        const auto [type_index, phase] = uncommitted.back();
+        uncommitted.pop_back();
+        auto& type = types[type_index];
+        --type.commits;
+        if (rolled_back) {
+          ++type.rollbacks;
+          continue;
+        }
+        stat.discardElapsed();
+        type.latencies.pop_back();
+        ++type.errors;
+        if (!std::empty(target_stats)) {
+          target_stats[target].latencies.pop_back();
+          ++target_stats[target].errors;
+        }
+        if (!std::empty(phase_stats)) {
+          phase_stats[phase].latencies.pop_back();
+          ++phase_stats[phase].errors;
+        }
+      }
+      uncommitted.clear();
+    };
+
+    auto& mt = generator.random();
+    auto& usage = stat.usage();
+    auto& live = metrics_.slot(worker);
+    Clock::duration generation_time(0), driver_time(0);
+
+    ThreadUsage thread_usage;
+    thread_usage.start();
+    if (use_perf) {
+      perf_counters.start();
+    }
+    const auto loop_begin = Clock::now();
+
+    limiter.start();
+    for (std::size_t i = 0; i < count; ++i) {
+      // with a schedule the worker runs while it lasts
+      std::size_t phase = 0;
+      if (!profile.empty()) {
+        const auto at = profile.await(worker, run_start_, limiter);
+        if (!at) {
+          break;
+        }
+        phase = *at;
+      }
+
+      const auto generation_begin = Clock::now();
+      const auto& setting = generator.next();
+      generation_time += Clock::now() - generation_begin;
 
-    using Clock = std::chrono::system_clock;
+      limiter.postpone(setting.keying_time.pause(mt));
+      const auto delay = limiter.wait();
+
+      const auto target = router.route(generator, cursor);
+      auto& db = dbs[target];
+      if (last_target && *last_target != target && dbs[*last_target]) {
+        discard(controller.finish(*dbs[*last_target]), *last_target);
+      }
+      last_target = target;
+
+      bool is_first_transaction = false;
+      if (reconnect_every > 0 && (i % reconnect_every == 0 || !db)) {
+        if (db) {
+          discard(controller.finish(*db), target);
+        }
+        db.reset();
+        const auto connect_begin = Clock::now();
+        try {
+          db = create(targets[target].properties);
+        } catch (const std::exception& e) {
+          if (stat.connections().errors++ == 0) {
+            std::cerr << "error: " << e.what() << std::endl;
+          }
+        }
+        const auto connect_end = Clock::now();
+        driver_time += connect_end - connect_begin;
+
+        if (!db) {
+          stat.addEntry(false, connect_begin, connect_end, delay);
+          ++types[generator.type()].errors;
+          if (!std::empty(target_stats)) {
+            ++target_stats[target].errors;
+          }
+          if (!std::empty(phase_stats)) {
+            ++phase_stats[phase].errors;
+          }
+          live.addError(generator.type(), database::ErrorClass::kConnection,
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            connect_end - connect_begin + delay));
+          limiter.postpone(setting.think_time.pause(mt));
+          continue;
+        }
+        stat.connections().connect.emplace_back(connect_end - connect_begin);
+        is_first_transaction = true;
+      }
 
-    for (const auto& queries : transactions) {
       bool is_success = true;
+      auto error_class = database::ErrorClass::kOther;
       auto begin = Clock::now();
 
       try {
-        for (const auto& query : queries) {
-          db->execute(query);
+        controller.run(generator, *db, mt);
+      } catch (const database::DatabaseError& e) {
+        is_success = false;
+        error_class = e.errorClass();
+        if (capturing) {
+          error_message.assign(e.what());
+        }
+      } catch (const std::exception& e) {
+        is_success = false;
+        if (capturing) {
+          error_message.assign(e.what());
         }
       } catch (...) {
         is_success = false;
+        if (capturing) {
+          error_message.assign("unknown error");
+        }
       }
 
       auto end = Clock::now();
+      driver_time += end - begin;
+      if (controller.rolledBackRuns() > 0) {
+        discard(controller.rolledBackRuns(), target, true);
+      }
+
+      stat.addEntry(is_success, begin, end, delay);
+
+      const auto latency =
+          std::chrono::duration_cast<Statistics::ElapsedTimeType>(end - begin +
+                                                                  delay);
+      const auto latency_us =
+          std::chrono::duration_cast<std::chrono::microseconds>(latency);
+      if (capturing) {
+        const auto start =
+            std::chrono::duration_cast<Statistics::ElapsedTimeType>(
+                begin - run_start_);
+        if (tb_likely(is_success)) {
+          capture.success(generator, controller.statementTimes(), worker,
+                          start, latency);
+        } else {
+          capture.error(generator, controller.statementTimes(), worker, start,
+                        latency, error_message);
+        }
+      }
+      if (is_first_transaction) {
+        stat.connections().first_transaction.emplace_back(latency);
+      }
+      auto& type = types[generator.type()];
+      type.savepoints += controller.savepoints();
+      type.savepoint_rollbacks += controller.savepointRollbacks();
+      if (!std::empty(target_stats)) {
+        auto& target_stat = target_stats[target];
+        if (tb_likely(is_success)) {
+          target_stat.latencies.emplace_back(latency);
+        } else {
+          ++target_stat.errors;
+        }
+      }
+      if (!std::empty(phase_stats)) {
+        auto& phase_stat = phase_stats[phase];
+        if (tb_likely(is_success)) {
+          phase_stat.latencies.emplace_back(latency);
+        } else {
+          ++phase_stat.errors;
+        }
+      }
+      if (tb_likely(is_success)) {
+        live.addSuccess(generator.type(), latency_us);
+        type.latencies.emplace_back(latency);
+        ++(controller.rolledBack() ? type.rollbacks : type.commits);
+        if (controller.pending() <= 1) {
+          uncommitted.clear();
+        }
+        if (controller.pending() > 0) {
+          uncommitted.emplace_back(generator.type(), phase);
+        }
+      } else {
+        live.addError(generator.type(), error_class, latency_us);
+        ++type.errors;
+        // leave an aborted transaction so the next one can begin
+        discard(controller.abort(*db), target);
+      }
+
+      limiter.postpone(setting.think_time.pause(mt));
+    }
 
-      stat.addEntry(is_success, begin, end);
+    // statements of an incomplete batch
+    if (last_target && dbs[*last_target]) {
+      discard(controller.finish(*dbs[*last_target]), *last_target);
     }
 
+    // everything but rendering and the driver is pausing and pacing
+    const auto loop_time = Clock::now() - loop_begin;
+    if (use_perf) {
+      perf_counters.stop(usage);
+    }
+    thread_usage.stop(usage);
+
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    usage.generation = duration_cast<microseconds>(generation_time);
+    usage.driver = duration_cast<microseconds>(driver_time);
+    const auto loop_us = duration_cast<microseconds>(loop_time);
+    usage.wait =
+        std::max(microseconds(0), loop_us - usage.generation - usage.driver);
+
     return stat;
   }
 
- public:
-  Statistics execute(const Configuration& config, const Properties& props) {
+  // forks the worker processes, which start together at a barrier in
+  // shared memory and leave their results there for the parent to merge.
+  // their live metrics are counted in the shared memory as well.
+  // helper threads of the parent, the metrics server or a server sampler,
+  // may already run and do not exist in a child. a child touches none of
+  // their state but the live metrics, whose lock is held across the fork.
+  Statistics executeProcesses(const Configuration& config,
+                              const Properties& props) {
+    const auto processes = config.processes();
+    const auto targets = Router(config, props).statistics();
+    const auto phases = LoadProfile(config).statistics();
+    if (config.capture().enabled()) {
+      std::cerr << "warning: transactions are not captured in worker processes"
+                << std::endl;
+    }
+    if (config.serverMetrics()) {
+      std::cerr << "warning: server metrics are not sampled with worker "
+                   "processes"
+                << std::endl;
+    }
+    SharedResults shared({processes, config.threadCount(), config.count(),
+                          std::size(config.transactions()),
+                          std::size(targets), std::size(phases)});
+    metrics_.types(TypeNames(config));
+    metrics_.share(shared.live(), processes * config.threadCount());
+
+    std::cout.flush();
+    std::cerr.flush();
+    std::vector<pid_t> children;
+    for (std::size_t p = 0; p < processes; ++p) {
+      pid_t pid;
+      {
+        const auto lock = metrics_.lock();
+        pid = fork();
+      }
+      if (pid < 0) {
+        // the forked ones must not wait for the missing ones
+        for (auto q = p; q < processes; ++q) {
+          shared.arrive(q);
+        }
+        std::cerr << "error: cannot fork worker process" << std::endl;
+        break;
+      }
+      if (pid == 0) {
+        process_index_ = p;
+        start_gate_ = [&shared, p] {
+          shared.arrive(p);
+          shared.wait();
+        };
+        int status = 0;
+        try {
+          shared.store(p, executeThreads(config, props));
+        } catch (const std::exception& e) {
+          std::cerr << "error: " << e.what() << std::endl;
+          status = 1;
+        }
+        shared.arrive(p);
+        connections_.clear();
+        // _exit does not flush, and backends report errors on both
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(status);
+      }
+      children.emplace_back(pid);
+    }
+
+    metrics_.activeThreads(std::size(children) * config.threadCount());
+    for (std::size_t p = 0; p < std::size(children); ++p) {
+      int status = 0;
+      waitpid(children[p], &status, 0);
+      // a crashed process would hold the others at the barrier
+      shared.arrive(p);
+      if (!shared.completed(p)) {
+        std::cerr << "warning: worker process " << p
+                  << " failed, its threads are not counted" << std::endl;
+      }
+    }
+    metrics_.activeThreads(0);
+    metrics_.unshare();
+
+    auto statistics = shared.merge(config.name(), TransactionTypes(config),
+                                   targets, phases);
+    statistics.timer(std::string(Clock::ToString(Clock::source())),
+                     Clock::Overhead());
+    return statistics;
+  }
+
+  Statistics executeThreads(const Configuration& config,
+                            const Properties& props) {
     thread_counter_ = 0;
 
     std::vector<std::future<InternalStat>> stat_futures;
     stat_futures.reserve(config.threadCount());
 
+    if (std::size(connections_) < config.threadCount()) {
+      connections_.resize(config.threadCount());
+    }
+
+    metrics_.types(TypeNames(config));
+
+    const Router router(config, props);
+
+    // against the first target, which is a primary
+    std::unique_ptr<ServerSampler> sampler;
+    if (const auto& interval = config.serverMetrics()) {
+      try {
+        sampler = std::make_unique<ServerSampler>(
+            create(router.targets().front().properties), metrics_, *interval);
+      } catch (const std::exception& e) {
+        std::cerr << "warning: server metrics sampler cannot connect: "
+                  << e.what() << std::endl;
+      }
+    }
+
     shared_mutex_.lock();
 
     for (std::size_t i = 0; i < config.threadCount(); ++i) {
-      stat_futures.emplace_back(std::async(
-          std::launch::async, [&] { return executeImpl(config, props); }));
+      stat_futures.emplace_back(std::async(std::launch::async, [&, i] {
+        return executeImpl(config, router, i);
+      }));
     }
 
     while (thread_counter_ < config.threadCount()) {
       std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
+    if (start_gate_) {
+      start_gate_();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    run_start_ = Clock::now();
+    if (sampler) {
+      sampler->start(run_start_);
+    }
+    metrics_.activeThreads(config.threadCount());
     shared_mutex_.unlock();
 
     std::vector<InternalStat> iss(std::size(stat_futures));
     std::transform(
         std::begin(stat_futures), std::end(stat_futures), std::begin(iss),
         [](std::future<InternalStat>& future) { return future.get(); });
+    const auto duration =
+        std::chrono::duration_cast<Statistics::ElapsedTimeType>(
+            std::chrono::steady_clock::now() - start);
+    metrics_.activeThreads(0);
+    auto server_metrics = sampler ? sampler->stop() : ServerMetricsSeries();
 
     std::vector<Statistics::ElapsedTImesPerThreadType> etpts(std::size(iss));
     std::transform(
         std::begin(iss), std::end(iss), std::begin(etpts),
         [](const InternalStat& is) { return is.toStatisticsElement(); });
 
-    return Statistics(config.name(), config.threadCount(), etpts);
+    std::vector<ClientUsage> usages(std::size(iss));
+    std::transform(std::begin(iss), std::end(iss), std::begin(usages),
+                   [](const InternalStat& is) { return is.usage(); });
+
+    std::vector<TransactionTypeStatistics> types;
+    auto targets = router.statistics();
+    auto phases = LoadProfile(config).statistics();
+    ConnectionTimes connections;
+    for (const auto& is : iss) {
+      const auto& thread_targets = is.targets();
+      for (std::size_t t = 0; t < std::size(thread_targets); ++t) {
+        targets[t].merge(thread_targets[t]);
+      }
+      const auto& thread_phases = is.phases();
+      for (std::size_t p = 0; p < std::size(thread_phases); ++p) {
+        phases[p].merge(thread_phases[p]);
+      }
+      // threads which could not connect have no types
+      const auto& thread_types = is.transactionTypes();
+      if (std::empty(types)) {
+        types = thread_types;
+      } else if (!std::empty(thread_types)) {
+        for (std::size_t t = 0; t < std::size(types); ++t) {
+          types[t].merge(thread_types[t]);
+        }
+      }
+      const auto& c = is.connections();
+      connections.connect.insert(std::end(connections.connect),
+                                 std::begin(c.connect), std::end(c.connect));
+      connections.first_transaction.insert(
+          std::end(connections.first_transaction),
+          std::begin(c.first_transaction), std::end(c.first_transaction));
+      connections.errors += c.errors;
+    }
+
+    Statistics statistics(config.name(), config.threadCount(), etpts,
+                          duration);
+    statistics.timer(std::string(Clock::ToString(Clock::source())),
+                     Clock::Overhead());
+    statistics.clientUsages(std::move(usages));
+    statistics.connections(std::move(connections));
+    statistics.transactionTypes(std::move(types));
+    statistics.targets(std::move(targets));
+    statistics.phases(std::move(phases));
+    statistics.serverMetrics(std::move(server_metrics));
+    if (config.capture().enabled()) {
+      std::vector<TransactionCapture> captures;
+      for (auto& is : iss) {
+        captures.emplace_back(std::move(is.capture()));
+      }
+      TransactionCapture::Merge(std::move(captures), config.capture(),
+                                statistics);
+    }
+    return statistics;
+  }
+
+  // latencies of the threads of each group, threads of processes follow
+  // each other
+  static std::vector<GroupStatistics> Groups(const Configuration& config,
+                                             const Statistics& statistics) {
+    std::vector<GroupStatistics> groups;
+    std::vector<std::size_t> group_of;
+    for (const auto& group : config.groups()) {
+      groups.emplace_back().name = group.name;
+      group_of.insert(std::end(group_of), group.threads,
+                      std::size(groups) - 1);
+    }
+    const auto& usages = statistics.clientUsages();
+    for (std::size_t i = 0; i < statistics.threadCount(); ++i) {
+      auto& group = groups[group_of[i % std::size(group_of)]];
+      ++group.threads;
+      const auto thread_id = static_cast<int>(i);
+      const auto success =
+          statistics.concat<Statistics::kSuccessIndex>(thread_id);
+      group.latencies.insert(std::end(group.latencies), std::begin(success),
+                             std::end(success));
+      group.errors +=
+          std::size(statistics.concat<Statistics::kErrorIndex>(thread_id));
+      if (i < std::size(usages)) {
+        const auto& usage = usages[i];
+        group.duration = std::max<Statistics::ElapsedTimeType>(
+            group.duration, usage.generation + usage.driver + usage.wait);
+      }
+    }
+    return groups;
+  }
+
+  // most statements a transaction of the workload sends
+  static std::size_t MaxStatements(const Configuration& config) {
+    std::size_t statements = 0;
+    for (const auto& transaction : config.transactions()) {
+      statements = std::max(statements, std::size(transaction.templates));
+    }
+    return statements;
+  }
+
+  static std::vector<std::string> TypeNames(const Configuration& config) {
+    std::vector<std::string> names;
+    for (const auto& transaction : config.transactions()) {
+      names.emplace_back(transaction.name);
+    }
+    return names;
+  }
+
+  static std::vector<TransactionTypeStatistics> TransactionTypes(
+      const Configuration& config) {
+    std::vector<TransactionTypeStatistics> types;
+    for (const auto& transaction : config.transactions()) {
+      auto& type = types.emplace_back();
+      type.name = transaction.name;
+      type.isolation = transaction.control.isolationName();
+      type.read_only = transaction.control.options.read_only;
+    }
+    return types;
+  }
+
+ public:
+  Statistics execute(const Configuration& config, const Properties& props) {
+    auto statistics = config.processes() > 1
+                          ? executeProcesses(config, props)
+                          : executeThreads(config, props);
+    if (!std::empty(config.groups())) {
+      statistics.groups(Groups(config, statistics));
+    }
+    return statistics;
   }
 };
 
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <database.hpp>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace tb {
+
+// counters updated by workers while they run, readable at any time.
+// every worker owns a slot and is its only writer, so updates are plain
+// relaxed stores and readers never block workers.
+class LiveMetrics {
+ public:
+  // upper bounds of latency buckets in microseconds, +Inf is implicit
+  inline static constexpr std::array<std::int64_t, 16> kBuckets = {
+      50,    100,    250,    500,    1000,   2500,    5000,    10000,
+      25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000};
+
+  struct TypeCounters {
+    std::atomic<std::uint64_t> success{0};
+    std::array<std::atomic<std::uint64_t>, database::kErrorClassCount> errors{};
+    std::array<std::atomic<std::uint64_t>, std::size(kBuckets) + 1> buckets{};
+    std::atomic<std::uint64_t> latency_sum_us{0};
+  };
+
+  // sums over every worker and type
+  struct Totals {
+    std::uint64_t success = 0, errors = 0, latency_sum_us = 0;
+    std::array<std::uint64_t, std::size(kBuckets) + 1> buckets{};
+  };
+
+  class alignas(64) Slot {
+   private:
+    std::unique_ptr<TypeCounters[]> owned_;
+    TypeCounters* types_;
+    std::size_t type_count_;
+
+   public:
+    explicit Slot(std::size_t type_count)
+        : owned_(std::make_unique<TypeCounters[]>(type_count)),
+          types_(owned_.get()),
+          type_count_(type_count) {}
+
+    // counters owned by someone else, such as shared memory
+    Slot(TypeCounters* types, std::size_t type_count)
+        : types_(types), type_count_(type_count) {}
+
+   public:
+    [[nodiscard]] std::size_t typeCount() const noexcept {
+      return type_count_;
+    }
+
+    [[nodiscard]] const TypeCounters& type(std::size_t index) const {
+      return types_[index];
+    }
+
+    void addSuccess(std::size_t type, std::chrono::microseconds latency) {
+      auto& counters = types_[type];
+      Increment(counters.success);
+      AddLatency(counters, latency);
+    }
+
+    void addError(std::size_t type, database::ErrorClass error_class,
+                  std::chrono::microseconds latency) {
+      auto& counters = types_[type];
+      Increment(counters.errors[static_cast<std::size_t>(error_class)]);
+      AddLatency(counters, latency);
+    }
+
+    // adds the counts of other, which nobody writes anymore
+    void add(const Slot& other) {
+      for (std::size_t t = 0; t < std::min(type_count_, other.type_count_);
+           ++t) {
+        auto& to = types_[t];
+        const auto& from = other.types_[t];
+        Increment(to.success, from.success.load());
+        for (std::size_t e = 0; e < std::size(to.errors); ++e) {
+          Increment(to.errors[e], from.errors[e].load());
+        }
+        for (std::size_t b = 0; b < std::size(to.buckets); ++b) {
+          Increment(to.buckets[b], from.buckets[b].load());
+        }
+        Increment(to.latency_sum_us, from.latency_sum_us.load());
+      }
+    }
+
+   private:
+    static void Increment(std::atomic<std::uint64_t>& counter,
+                          std::uint64_t value = 1) {
+      counter.store(counter.load(std::memory_order_relaxed) + value,
+                    std::memory_order_relaxed);
+    }
+
+    static void AddLatency(TypeCounters& counters,
+                           std::chrono::microseconds latency) {
+      const auto us = latency.count();
+      std::size_t bucket = 0;
+      while (bucket < std::size(kBuckets) && us > kBuckets[bucket]) {
+        ++bucket;
+      }
+      Increment(counters.buckets[bucket]);
+      Increment(counters.latency_sum_us, static_cast<std::uint64_t>(
+                                             std::max<std::int64_t>(0, us)));
+    }
+  };
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::string> type_names_;
+  std::vector<std::unique_ptr<Slot>> slots_;
+  // slots of worker processes in shared memory while they run
+  std::vector<std::unique_ptr<Slot>> shared_slots_;
+  std::atomic<std::size_t> active_threads_{0};
+
+ public:
+  // (re)defines transaction types, existing counts are kept
+  void types(std::vector<std::string> names) {
+    std::lock_guard lg(mutex_);
+    if (names != type_names_) {
+      type_names_ = std::move(names);
+      slots_.clear();
+    }
+  }
+
+  // slot of a worker, registered once per worker and run
+  Slot& slot(std::size_t thread_id) {
+    std::lock_guard lg(mutex_);
+    if (!std::empty(shared_slots_)) {
+      return *shared_slots_.at(thread_id);
+    }
+    while (std::size(slots_) <= thread_id) {
+      slots_.emplace_back(std::make_unique<Slot>(std::size(type_names_)));
+    }
+    return *slots_[thread_id];
+  }
+
+  // workers of forked processes count into slots of counters of every type
+  // in shared memory, which the parent reads while they run
+  void share(TypeCounters* counters, std::size_t slots) {
+    std::lock_guard lg(mutex_);
+    shared_slots_.clear();
+    for (std::size_t s = 0; s < slots; ++s) {
+      shared_slots_.emplace_back(std::make_unique<Slot>(
+          counters + s * std::size(type_names_), std::size(type_names_)));
+    }
+  }
+
+  // keeps the counts of the shared slots before their memory goes away
+  void unshare() {
+    std::lock_guard lg(mutex_);
+    for (std::size_t s = 0; s < std::size(shared_slots_); ++s) {
+      while (std::size(slots_) <= s) {
+        slots_.emplace_back(std::make_unique<Slot>(std::size(type_names_)));
+      }
+      slots_[s]->add(*shared_slots_[s]);
+    }
+    shared_slots_.clear();
+  }
+
+  // held by a process across fork(), so a child does not inherit it locked
+  // by a reader such as the metrics server
+  [[nodiscard]] std::unique_lock<std::mutex> lock() const {
+    return std::unique_lock(mutex_);
+  }
+
+  void activeThreads(std::size_t count) noexcept {
+    active_threads_.store(count, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] Totals totals() const {
+    std::lock_guard lg(mutex_);
+    Totals totals;
+    for (const auto& slot : allSlots()) {
+      for (std::size_t t = 0; t < slot->typeCount(); ++t) {
+        const auto& counters = slot->type(t);
+        totals.success += counters.success.load(std::memory_order_relaxed);
+        for (const auto& errors : counters.errors) {
+          totals.errors += errors.load(std::memory_order_relaxed);
+        }
+        for (std::size_t b = 0; b < std::size(totals.buckets); ++b) {
+          totals.buckets[b] +=
+              counters.buckets[b].load(std::memory_order_relaxed);
+        }
+        totals.latency_sum_us +=
+            counters.latency_sum_us.load(std::memory_order_relaxed);
+      }
+    }
+    return totals;
+  }
+
+  // Prometheus text exposition format 0.0.4
+  [[nodiscard]] std::string render() const {
+    std::lock_guard lg(mutex_);
+    std::ostringstream os;
+
+    const auto slots = allSlots();
+    const auto sum = [&slots](std::size_t type, const auto& get) {
+      std::uint64_t value = 0;
+      for (const auto* slot : slots) {
+        value += get(slot->type(type)).load(std::memory_order_relaxed);
+      }
+      return value;
+    };
+
+    os << "# HELP tx_bench_threads Worker threads of the running benchmark.\n"
+       << "# TYPE tx_bench_threads gauge\n"
+       << "tx_bench_threads " << active_threads_.load() << "\n";
+
+    os << "# HELP tx_bench_transactions_total Committed transactions.\n"
+       << "# TYPE tx_bench_transactions_total counter\n";
+    for (std::size_t t = 0; t < std::size(type_names_); ++t) {
+      os << "tx_bench_transactions_total{type=\"" << type_names_[t] << "\"} "
+         << sum(t, [](const TypeCounters& c) -> const auto& {
+              return c.success;
+            })
+         << "\n";
+    }
+
+    os << "# HELP tx_bench_errors_total Failed transactions by error class.\n"
+       << "# TYPE tx_bench_errors_total counter\n";
+    for (std::size_t t = 0; t < std::size(type_names_); ++t) {
+      for (std::size_t e = 0; e < database::kErrorClassCount; ++e) {
+        os << "tx_bench_errors_total{type=\"" << type_names_[t]
+           << "\",class=\""
+           << database::ToString(static_cast<database::ErrorClass>(e))
+           << "\"} "
+           << sum(t, [e](const TypeCounters& c) -> const auto& {
+                return c.errors[e];
+              })
+           << "\n";
+      }
+    }
+
+    os << "# HELP tx_bench_transaction_duration_seconds Transaction latency.\n"
+       << "# TYPE tx_bench_transaction_duration_seconds histogram\n";
+    for (std::size_t t = 0; t < std::size(type_names_); ++t) {
+      std::uint64_t cumulative = 0;
+      for (std::size_t b = 0; b <= std::size(kBuckets); ++b) {
+        cumulative += sum(t, [b](const TypeCounters& c) -> const auto& {
+          return c.buckets[b];
+        });
+        os << "tx_bench_transaction_duration_seconds_bucket{type=\""
+           << type_names_[t] << "\",le=\"";
+        if (b < std::size(kBuckets)) {
+          os << static_cast<double>(kBuckets[b]) / 1e6;
+        } else {
+          os << "+Inf";
+        }
+        os << "\"} " << cumulative << "\n";
+      }
+      os << "tx_bench_transaction_duration_seconds_sum{type=\""
+         << type_names_[t] << "\"} "
+         << static_cast<double>(
+                sum(t, [](const TypeCounters& c) -> const auto& {
+                  return c.latency_sum_us;
+                })) /
+                1e6
+         << "\n"
+         << "tx_bench_transaction_duration_seconds_count{type=\""
+         << type_names_[t] << "\"} " << cumulative << "\n";
+    }
+    return os.str();
+  }
+
+ private:
+  // called with the lock held
+  [[nodiscard]] std::vector<const Slot*> allSlots() const {
+    std::vector<const Slot*> slots;
+    for (const auto& slot : slots_) {
+      slots.emplace_back(slot.get());
+    }
+    for (const auto& slot : shared_slots_) {
+      slots.emplace_back(slot.get());
+    }
+    return slots;
+  }
+};
+
+}  // namespace tb
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <configuration.hpp>
+#include <optional>
+#include <statistics.hpp>
+#include <thread>
+#include <vector>
+
+#include "clock.hpp"
+#include "rate_limiter.hpp"
+
+namespace tb {
+
+// the load schedule of a workload as workers follow it. workers beyond the
+// active threads of a phase are parked, the active ones share its rate.
+class LoadProfile {
+ public:
+  // where in the schedule a time since the start is
+  struct Position {
+    std::size_t phase;
+    // through the phase, from 0 to 1
+    double progress;
+  };
+
+ private:
+  inline static constexpr std::chrono::milliseconds kParkInterval{10};
+
+  const std::vector<PhaseSetting>& phases_;
+  // end of each phase since the start
+  std::vector<Clock::duration> ends_;
+  std::size_t workers_;
+  double rate_;
+
+ public:
+  explicit LoadProfile(const Configuration& config)
+      : phases_(config.schedule()),
+        workers_(config.threadCount() * config.processes()),
+        rate_(config.rate()) {
+    Clock::duration end(0);
+    for (const auto& phase : phases_) {
+      end += phase.duration;
+      ends_.emplace_back(end);
+    }
+  }
+
+ public:
+  [[nodiscard]] bool empty() const noexcept { return std::empty(phases_); }
+
+  // statistics named after the phases, nothing without a schedule
+  [[nodiscard]] std::vector<PhaseStatistics> statistics() const {
+    std::vector<PhaseStatistics> statistics;
+    for (std::size_t p = 0; p < std::size(phases_); ++p) {
+      auto& s = statistics.emplace_back();
+      s.name = phases_[p].name;
+      s.start = ends_[p] - phases_[p].duration;
+      s.duration = phases_[p].duration;
+    }
+    return statistics;
+  }
+
+  // nullopt once the schedule is over
+  [[nodiscard]] std::optional<Position> at(Clock::duration elapsed) const {
+    const auto end = std::upper_bound(std::begin(ends_), std::end(ends_),
+                                      elapsed);
+    if (end == std::end(ends_)) {
+      return std::nullopt;
+    }
+    const auto phase = static_cast<std::size_t>(end - std::begin(ends_));
+    const auto into = elapsed - (*end - phases_[phase].duration);
+    return Position{phase, std::chrono::duration<double>(into) /
+                               phases_[phase].duration};
+  }
+
+  [[nodiscard]] std::size_t threads(const Position& position) const {
+    const auto& threads = phases_[position.phase].threads;
+    if (!threads) {
+      return workers_;
+    }
+    const auto active = std::lround(threads->at(position.progress));
+    return std::min(static_cast<std::size_t>(std::max(active, 0L)),
+                    workers_);
+  }
+
+  // transactions per second of all active workers, 0 means unlimited
+  [[nodiscard]] double rate(const Position& position) const {
+    const auto& rate = phases_[position.phase].rate;
+    return rate ? rate->at(position.progress) : rate_;
+  }
+
+  // blocks while worker is parked and paces limiter to its share of the
+  // rate of the phase at hand. returns the phase, nullopt once the schedule
+  // is over.
+  std::optional<std::size_t> await(std::size_t worker,
+                                   Clock::time_point start,
+                                   RateLimiter& limiter) const {
+    auto parked = false;
+    while (true) {
+      const auto position = at(Clock::now() - start);
+      if (!position) {
+        return std::nullopt;
+      }
+      const auto threads = this->threads(*position);
+      if (worker < threads) {
+        if (parked) {
+          limiter.start();  // the parked time is not owed
+        }
+        limiter.rate(rate(*position) / static_cast<double>(threads));
+        return position->phase;
+      }
+      parked = true;
+      std::this_thread::sleep_for(kParkInterval);
+    }
+  }
+};
+
+}  // namespace tb
@@ -2,22 +2,68 @@
 #include <configuration.hpp>
 #include <database_creator.hpp>
 #include <iostream>
+#include <sstream>
 
+#include "comparison.hpp"
 #include "executor.hpp"
+#include "metrics_server.hpp"
+#include "repeater.hpp"
+#include "replayer.hpp"
+#include "slo_searcher.hpp"
+#include "sweeper.hpp"
 
 namespace {
 
-template <class F>
-tb::Statistics Execute(const tb::Configuration& config,
-                       const tb::Properties& props, F&& f) {
-  tb::Executor executor(std::forward<F>(f));
-  return executor.execute(config, props);
+// exit status of a comparison which crossed a regression threshold
+constexpr int kRegressionStatus = 2;
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::istringstream is(list);
+  for (std::string item; std::getline(is, item, ',');) {
+    if (!std::empty(item)) {
+      items.emplace_back(std::move(item));
+    }
+  }
+  return items;
 }
 
-tb::Statistics ExecuteByName(const std::string& name,
-                             const tb::Configuration& config,
-                             const tb::Properties& props) {
-  return Execute(config, props, tb::database::GetDatabaseCreator(name));
+// a run is one of these modes at most, and only a single run writes the
+// capture, server metrics and histogram outputs. an option nothing would
+// act on is an error rather than silently dropped.
+void CheckModes(const tb::Configuration& config, bool comparison,
+                bool histogram) {
+  std::vector<std::string> modes, outputs;
+  if (comparison) {
+    modes.emplace_back("comparison");
+  }
+  if (config.sweep()) {
+    modes.emplace_back("sweep");
+  }
+  if (config.slo()) {
+    modes.emplace_back("slo");
+  }
+  if (config.repeat()) {
+    modes.emplace_back("repeat");
+  }
+  if (config.capture().enabled()) {
+    outputs.emplace_back("capture");
+  }
+  if (config.serverMetrics()) {
+    outputs.emplace_back("server metrics");
+  }
+  if (histogram) {
+    outputs.emplace_back("histogram");
+  }
+
+  if (std::size(modes) > 1) {
+    throw std::runtime_error(modes[0] + " cannot be combined with " +
+                             modes[1]);
+  }
+  if (!std::empty(modes) && !std::empty(outputs)) {
+    throw std::runtime_error(outputs[0] + " is not available with " +
+                             modes[0]);
+  }
 }
 
 }  // namespace
@@ -26,55 +72,319 @@ int main(const int argc, const char* const* const argv) {
   argparse::ArgumentParser parser("tx-bench");
   parser.addArgument({"--workload", "-w"}, "workload configuration file");
   parser.addArgument({"--threads"}, "thread count (overwrite configuration)");
+  parser.addArgument({"--processes"},
+                     "worker processes, each running --threads threads "
+                     "(overwrite configuration)");
   parser.addArgument({"--result", "-r"}, "result output (default: stdout)");
-  parser.addArgument({"--properties", "-p"}, "properties file");
-  parser.addArgument({"--database", "--db", "-d"}, "database name");
+  parser.addArgument({"--properties", "-p"},
+                     "properties file (comma separated: one per database)");
+  parser.addArgument({"--database", "--db", "-d"},
+                     "database name (comma separated: run each and compare)");
   parser.addArgument({"--histogram"}, "success histogram output file");
-  parser.addArgument({"--histogram-width"}, "histogram rank width");
+  parser.addArgument({"--histogram-width"}, "histogram rank width in ns");
+  parser.addArgument({"--sweep"},
+                     "sweep thread count over range min-max (overwrite "
+                     "configuration)");
+  parser.addArgument({"--metrics-port"},
+                     "serve live metrics in Prometheus format on "
+                     "localhost:port");
+  parser.addArgument({"--rate"},
+                     "transactions per second of all threads (overwrite "
+                     "configuration)");
+  parser.addArgument({"--reconnect-every"},
+                     "reconnect and time it every n transactions (overwrite "
+                     "configuration)");
+  parser.addArgument({"--repeat"},
+                     "run the workload n times and summarize the trials "
+                     "(overwrite configuration)");
+  parser.addArgument({"--seed"},
+                     "seed of worker random generators (overwrite "
+                     "configuration)");
+  parser.addArgument({"--timer"},
+                     "latency clock: steady or tsc (overwrite configuration)");
+  parser.addArgument({"--capture"},
+                     "keep the n slowest transactions and n sampled errors "
+                     "with their statements (overwrite configuration)");
+  parser.addArgument({"--capture-report"},
+                     "captured transactions output file (default: "
+                     "capture.yml)");
+  parser.addArgument({"--server-metrics"},
+                     "sample server metrics every n ms (overwrite "
+                     "configuration)");
+  parser.addArgument({"--server-metrics-output"},
+                     "client and server time series output file (default: "
+                     "server_metrics.csv)");
+  parser.addArgument({"--replay"},
+                     "query log to replay instead of a workload (postgres "
+                     "csvlog, mysql general or slow log)");
+  parser.addArgument({"--replay-format"},
+                     "postgres, mysql_general or mysql_slow (default: by "
+                     "file)");
+  parser.addArgument({"--replay-speed"},
+                     "speed up factor of the log timing, 0 replays as fast as "
+                     "possible (default: 1)");
+  parser.addArgument({"--baseline"}, "result file to compare results with");
+  parser.addArgument({"--current"},
+                     "result file compared with --baseline instead of running");
+  parser.addArgument({"--regression-threshold"},
+                     "largest relative change of any metric in a comparison "
+                     "(overwrite configuration)");
 
   const auto args = parser.parseArgs(argc, argv);
 
-  std::string workload;
-  if (!args.get("workload", workload)) {
-    std::cerr << "error: --workload option was not provided" << std::endl;
-    return 1;
+  // two stored results are compared without running anything
+  std::string baseline_file, current_file;
+  const auto has_baseline = args.get("baseline", baseline_file);
+  if (has_baseline && args.get("current", current_file)) {
+    try {
+      tb::RegressionThresholds thresholds;
+      std::string workload;
+      if (args.get("workload", workload)) {
+        thresholds = tb::Configuration::Make(workload).regression();
+      }
+      double threshold;
+      if (args.get("regression-threshold", threshold)) {
+        thresholds = tb::RegressionThresholds::All(threshold);
+      }
+      tb::Comparison comparison(tb::ResultSummary::Load(baseline_file),
+                                thresholds);
+      comparison.add(tb::ResultSummary::Load(current_file));
+      comparison.print(std::cout);
+      return comparison.regressed() ? kRegressionStatus : 0;
+    } catch (const std::exception& e) {
+      std::cerr << "error: " << e.what() << std::endl;
+      return 1;
+    }
   }
 
-  tb::Properties props;
-  {
-    std::string prop_file;
-    if (args.get("properties", prop_file)) {
-      props = tb::Properties::Make(prop_file);
+  // the statements of a captured log are sent instead of a workload, one
+  // connection per concurrent session or at most --threads of them
+  std::string replay_file;
+  if (args.get("replay", replay_file)) {
+    try {
+      std::string database, format_name, prop_file, result_output_file;
+      if (!args.get("database", database)) {
+        std::cerr << "error: --database option was not provided" << std::endl;
+        return 1;
+      }
+      const auto format = args.get("replay-format", format_name)
+                              ? tb::QueryLog::ParseFormat(format_name)
+                              : tb::QueryLog::Detect(replay_file);
+      const auto props = args.get("properties", prop_file)
+                             ? tb::Properties::Make(prop_file)
+                             : tb::Properties();
+      const tb::QueryLog log(replay_file, format);
+      std::cerr << "replay: sessions=" << std::size(log.sessions())
+                << " statements=" << log.statements()
+                << " fingerprints=" << std::size(log.fingerprints())
+                << std::endl;
+
+      tb::Executor executor(tb::database::GetDatabaseCreator(database));
+      const auto result = tb::Replayer(executor).replay(
+          log, replay_file, props, args.safeGet<double>("replay-speed", 1.0),
+          args.safeGet<std::size_t>("threads", 0));
+      if (args.get("result", result_output_file)) {
+        std::ofstream fout(result_output_file);
+        result.dump(fout);
+      } else {
+        result.dump(std::cout);
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "error: " << e.what() << std::endl;
+      return 1;
     }
+    return 0;
   }
 
-  const auto config = tb::Configuration::Make(workload);
-
-  std::string database;
-  if (!args.get("database", database)) {
-    std::cerr << "error: --database option was not provided" << std::endl;
+  std::string workload;
+  if (!args.get("workload", workload)) {
+    std::cerr << "error: --workload option was not provided" << std::endl;
     return 1;
   }
+
   try {
-    const auto result = ExecuteByName(database, config, props);
+    std::vector<tb::Properties> props_list;
+    {
+      std::string prop_files;
+      if (args.get("properties", prop_files)) {
+        for (const auto& prop_file : SplitList(prop_files)) {
+          props_list.emplace_back(tb::Properties::Make(prop_file));
+        }
+      }
+      if (std::empty(props_list)) {
+        props_list.emplace_back();
+      }
+    }
+    const auto& props = props_list.front();
+
+    auto config = tb::Configuration::Make(workload);
+    {
+      std::size_t thread_count;
+      if (args.get("threads", thread_count)) {
+        config.threadCount(thread_count);
+      }
+      std::size_t processes;
+      if (args.get("processes", processes)) {
+        config.processes(processes);
+      }
+      double rate;
+      if (args.get("rate", rate)) {
+        config.rate(rate);
+      }
+      std::size_t reconnect_every;
+      if (args.get("reconnect-every", reconnect_every)) {
+        config.reconnectEvery(reconnect_every);
+      }
+      std::size_t trials;
+      if (args.get("repeat", trials)) {
+        auto setting = config.repeat().value_or(tb::RepeatSetting());
+        setting.trials = trials;
+        config.repeat(std::move(setting));
+      }
+      std::uint64_t seed;
+      if (args.get("seed", seed)) {
+        config.seed(seed);
+      }
+      double threshold;
+      if (args.get("regression-threshold", threshold)) {
+        config.regression(tb::RegressionThresholds::All(threshold));
+      }
+      std::string sweep_range;
+      if (args.get("sweep", sweep_range)) {
+        config.sweep(tb::SweepSetting::Parse(sweep_range));
+      }
+      std::size_t capture;
+      if (args.get("capture", capture)) {
+        config.capture({capture, capture});
+      }
+      long server_metrics;
+      if (args.get("server-metrics", server_metrics)) {
+        config.serverMetrics(std::chrono::milliseconds(server_metrics));
+      }
+      std::string timer;
+      if (args.get("timer", timer)) {
+        config.timer(std::move(timer));
+      }
+    }
 
-    std::string result_output_file;
-    if (args.get("result", result_output_file)) {
-      std::ofstream fout(result_output_file);
-      result.dump(fout);
-    } else {
-      result.dump(std::cout);
+    if (config.timer() == "tsc") {
+      if (!tb::Clock::Use(tb::Clock::Source::kTsc)) {
+        std::cerr << "warning: invariant tsc is not available, steady_clock is "
+                     "used"
+                  << std::endl;
+      }
+    } else if (config.timer() != "steady") {
+      std::cerr << "error: unknown timer: " << config.timer() << std::endl;
+      return 1;
     }
 
+    std::string database;
+    if (!args.get("database", database)) {
+      std::cerr << "error: --database option was not provided" << std::endl;
+      return 1;
+    }
+    const auto databases = SplitList(database);
+    if (std::empty(databases)) {
+      std::cerr << "error: --database option was empty" << std::endl;
+      return 1;
+    }
     std::string histogram_output_file;
-    if (args.get("histogram", histogram_output_file)) {
-      auto rank_width = args.safeGet<std::size_t>("histogram-width", 100);
+    const auto histogram = args.get("histogram", histogram_output_file);
+    CheckModes(config, std::size(databases) > 1 || has_baseline, histogram);
+
+    std::ofstream result_file;
+    {
+      std::string result_output_file;
+      if (args.get("result", result_output_file)) {
+        result_file.open(result_output_file);
+      }
+    }
+    std::ostream& result_output =
+        result_file.is_open() ? result_file : std::cout;
+    const auto dump_result = [&result_output](const auto& result) {
+      result.dump(result_output);
+    };
+    // every database runs the same seeded workload, the first one or the
+    // baseline file is compared with the others
+    if (std::size(databases) > 1 || has_baseline) {
+      if (!config.seed()) {
+        config.seed(std::random_device{}());
+      }
+
+      std::optional<tb::Comparison> comparison;
+      if (has_baseline) {
+        comparison.emplace(tb::ResultSummary::Load(baseline_file),
+                           config.regression());
+      }
+      for (std::size_t i = 0; i < std::size(databases); ++i) {
+        tb::Executor executor(tb::database::GetDatabaseCreator(databases[i]));
+        const auto result = executor.execute(
+            config, props_list[std::min(i, std::size(props_list) - 1)]);
+        if (i > 0) {
+          result_output << "---\n";
+        }
+        dump_result(result);
+
+        auto summary = tb::ResultSummary::Of(databases[i], result);
+        if (comparison) {
+          comparison->add(std::move(summary));
+        } else {
+          comparison.emplace(std::move(summary), config.regression());
+        }
+      }
+
+      // the table goes where results do not
+      auto& table_output = result_file.is_open() ? std::cout : std::cerr;
+      table_output << "seed: " << *config.seed() << "\n";
+      comparison->print(table_output);
+      return comparison->regressed() ? kRegressionStatus : 0;
+    }
+
+    tb::Executor executor(tb::database::GetDatabaseCreator(databases.front()));
+
+    std::unique_ptr<tb::MetricsServer> metrics_server;
+    std::uint16_t metrics_port;
+    if (args.get("metrics-port", metrics_port)) {
+      metrics_server = std::make_unique<tb::MetricsServer>(
+          metrics_port, [&executor] { return executor.metrics().render(); });
+    }
+
+    if (config.sweep()) {
+      dump_result(tb::Sweeper(executor).sweep(config, props));
+      return 0;
+    }
+    if (config.slo()) {
+      dump_result(tb::SloSearcher(executor).search(config, props));
+      return 0;
+    }
+    if (config.repeat()) {
+      dump_result(tb::Repeater(executor).repeat(config, props));
+      return 0;
+    }
+
+    const auto result = executor.execute(config, props);
+    dump_result(result);
+
+    if (config.capture().enabled()) {
+      std::ofstream fout(
+          args.safeGet<std::string>("capture-report", "capture.yml"));
+      result.dumpCaptured(fout);
+    }
+    if (config.serverMetrics()) {
+      std::ofstream fout(args.safeGet<std::string>("server-metrics-output",
+                                                   "server_metrics.csv"));
+      result.dumpServerMetrics(fout);
+    }
+
+    if (histogram) {
+      auto rank_width = args.safeGet<std::size_t>("histogram-width", 100000);
       std::ofstream fout(histogram_output_file);
       result.dumpHistogram(rank_width, fout);
     }
 
   } catch (const std::exception& e) {
     std::cerr << "error: " << e.what() << std::endl;
+    return 1;
   }
 
   return 0;
@@ -0,0 +1,92 @@
+#include "metrics_server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace tb {
+
+MetricsServer::MetricsServer(std::uint16_t port,
+                             std::function<std::string()> render)
+    : render_(std::move(render)) {
+  socket_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (socket_ < 0) {
+    throw std::runtime_error("cannot create metrics socket");
+  }
+  const int reuse = 1;
+  ::setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::bind(socket_, reinterpret_cast<sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(socket_, 16) != 0) {
+    ::close(socket_);
+    throw std::runtime_error("cannot listen metrics port " +
+                             std::to_string(port));
+  }
+
+  running_ = true;
+  thread_ = std::thread([this] { serve(); });
+}
+
+MetricsServer::~MetricsServer() {
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  ::close(socket_);
+}
+
+void MetricsServer::serve() {
+  while (running_) {
+    // wake up regularly to notice shutdown
+    pollfd fd{socket_, POLLIN, 0};
+    if (::poll(&fd, 1, 200) <= 0) {
+      continue;
+    }
+    const auto client = ::accept(socket_, nullptr, nullptr);
+    if (client < 0) {
+      continue;
+    }
+    respond(client);
+    ::close(client);
+  }
+}
+
+void MetricsServer::respond(int client) const {
+  // the request itself is not interpreted, only drained
+  char request[1024];
+  pollfd fd{client, POLLIN, 0};
+  if (::poll(&fd, 1, 1000) > 0) {
+    static_cast<void>(::recv(client, request, sizeof(request), 0));
+  }
+
+  const auto body = render_();
+  const auto response =
+      "HTTP/1.0 200 OK\r\n"
+      "Content-Type: text/plain; version=0.0.4\r\n"
+      "Content-Length: " +
+      std::to_string(std::size(body)) +
+      "\r\n"
+      "Connection: close\r\n\r\n" +
+      body;
+
+  std::size_t sent = 0;
+  while (sent < std::size(response)) {
+    const auto n = ::send(client, response.data() + sent,
+                          std::size(response) - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      break;
+    }
+    sent += static_cast<std::size_t>(n);
+  }
+}
+
+}  // namespace tb
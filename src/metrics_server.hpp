@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace tb {
+
+// minimal HTTP listener on localhost answering every GET with a body
+// rendered on request, enough for a Prometheus scrape or curl
+class MetricsServer {
+ private:
+  int socket_ = -1;
+  std::atomic<bool> running_{false};
+  std::function<std::string()> render_;
+  std::thread thread_;
+
+ public:
+  MetricsServer(std::uint16_t port, std::function<std::string()> render);
+
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer(MetricsServer&&) = delete;
+
+  MetricsServer& operator=(const MetricsServer&) = delete;
+  MetricsServer& operator=(MetricsServer&&) = delete;
+
+  ~MetricsServer();
+
+ private:
+  void serve();
+  void respond(int client) const;
+};
+
+}  // namespace tb
@@ -0,0 +1,662 @@
+#include "query_log.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+namespace {
+
+bool StartsWith(std::string_view text, std::string_view prefix) {
+  return text.substr(0, std::size(prefix)) == prefix;
+}
+
+std::string_view TrimRight(std::string_view text, std::string_view chars) {
+  const auto last = text.find_last_not_of(chars);
+  return last == std::string_view::npos ? std::string_view()
+                                        : text.substr(0, last + 1);
+}
+
+// days since 1970-01-01 of a proleptic gregorian date
+std::int64_t DaysFromCivil(std::int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const auto era = (y >= 0 ? y : y - 399) / 400;
+  const auto yoe = static_cast<unsigned>(y - era * 400);
+  const auto doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  const auto doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+// digits at pos, up to max_digits of them
+std::optional<std::int64_t> ReadNumber(std::string_view text, std::size_t& pos,
+                                       std::size_t max_digits) {
+  std::int64_t value = 0;
+  const auto begin = pos;
+  while (pos < std::size(text) && pos - begin < max_digits &&
+         std::isdigit(static_cast<unsigned char>(text[pos]))) {
+    value = value * 10 + (text[pos++] - '0');
+  }
+  if (pos == begin) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+// nanoseconds since the epoch of "2024-01-02 03:04:05.678 UTC",
+// "2024-01-02T03:04:05.678901Z" or "240102  3:04:05". zones are ignored,
+// only differences between the times of one log are used.
+std::optional<std::int64_t> ParseTime(std::string_view text) {
+  std::size_t pos = 0;
+  const auto date_begin = pos;
+  const auto date = ReadNumber(text, pos, 8);
+  if (!date) {
+    return std::nullopt;
+  }
+  std::int64_t year, month, day;
+  if (pos - date_begin == 6) {
+    year = 2000 + *date / 10000;
+    month = *date / 100 % 100;
+    day = *date % 100;
+  } else if (pos - date_begin == 4 && pos < std::size(text) &&
+             text[pos] == '-') {
+    year = *date;
+    ++pos;
+    const auto m = ReadNumber(text, pos, 2);
+    if (!m || pos >= std::size(text) || text[pos] != '-') {
+      return std::nullopt;
+    }
+    ++pos;
+    const auto d = ReadNumber(text, pos, 2);
+    if (!d) {
+      return std::nullopt;
+    }
+    month = *m;
+    day = *d;
+  } else {
+    return std::nullopt;
+  }
+
+  while (pos < std::size(text) && (text[pos] == ' ' || text[pos] == 'T')) {
+    ++pos;
+  }
+  std::int64_t clock[3];
+  for (int i = 0; i < 3; ++i) {
+    if (i > 0) {
+      if (pos >= std::size(text) || text[pos] != ':') {
+        return std::nullopt;
+      }
+      ++pos;
+    }
+    const auto value = ReadNumber(text, pos, 2);
+    if (!value) {
+      return std::nullopt;
+    }
+    clock[i] = *value;
+  }
+  std::int64_t fraction = 0;
+  if (pos < std::size(text) && text[pos] == '.') {
+    ++pos;
+    const auto begin = pos;
+    fraction = ReadNumber(text, pos, 9).value_or(0);
+    for (auto digits = pos - begin; digits < 9; ++digits) {
+      fraction *= 10;
+    }
+  }
+
+  const auto days = DaysFromCivil(year, static_cast<unsigned>(month),
+                                  static_cast<unsigned>(day));
+  const auto seconds =
+      days * 86400 + clock[0] * 3600 + clock[1] * 60 + clock[2];
+  return seconds * 1000000000 + fraction;
+}
+
+// nanoseconds of "1.234 ms" or of "0.000123" seconds
+std::int64_t ParseDuration(std::string_view text, double unit_ns) {
+  try {
+    return static_cast<std::int64_t>(std::stod(std::string(text)) * unit_ns);
+  } catch (const std::exception&) {
+    return 0;
+  }
+}
+
+// fields of the csv record at offset, quoted fields without their quotes
+// but with doubled quotes left in. returns where the next record starts.
+std::size_t ReadCsvRecord(std::string_view data, std::size_t offset,
+                          std::vector<std::string_view>& fields) {
+  fields.clear();
+  const auto size = std::size(data);
+  for (;;) {
+    std::string_view field;
+    if (offset < size && data[offset] == '"') {
+      const auto begin = offset + 1;
+      auto quote = data.find('"', begin);
+      while (quote != std::string_view::npos && quote + 1 < size &&
+             data[quote + 1] == '"') {
+        quote = data.find('"', quote + 2);
+      }
+      if (quote == std::string_view::npos) {
+        fields.emplace_back(data.substr(begin));
+        return size;
+      }
+      field = data.substr(begin, quote - begin);
+      offset = quote + 1;
+    } else {
+      auto end = data.find_first_of(",\r\n", offset);
+      if (end == std::string_view::npos) {
+        end = size;
+      }
+      field = data.substr(offset, end - offset);
+      offset = end;
+    }
+    fields.emplace_back(field);
+
+    if (offset < size && data[offset] == ',') {
+      ++offset;
+      continue;
+    }
+    // anything up to the end of line is not part of a well formed record
+    const auto newline = data.find('\n', offset);
+    return newline == std::string_view::npos ? size : newline + 1;
+  }
+}
+
+std::string Unescape(std::string_view field) {
+  std::string text;
+  text.reserve(std::size(field));
+  for (std::size_t i = 0; i < std::size(field); ++i) {
+    text += field[i];
+    if (field[i] == '"' && i + 1 < std::size(field) && field[i + 1] == '"') {
+      ++i;
+    }
+  }
+  return text;
+}
+
+// replaces $1, $2, ... of a prepared statement with the literals of
+// "parameters: $1 = '1', $2 = NULL" logged by postgres
+std::string BindParameters(std::string_view query, std::string_view detail) {
+  std::vector<std::string_view> values;
+  if (StartsWith(detail, "parameters: ")) {
+    auto rest = detail.substr(12);
+    while (!std::empty(rest) && rest.front() == '$') {
+      std::size_t pos = 1;
+      const auto index = ReadNumber(rest, pos, 9);
+      if (!index || *index == 0 || rest.substr(pos, 3) != " = ") {
+        break;
+      }
+      pos += 3;
+      auto end = pos;
+      if (end < std::size(rest) && rest[end] == '\'') {
+        for (++end; end < std::size(rest); ++end) {
+          if (rest[end] == '\'') {
+            if (end + 1 < std::size(rest) && rest[end + 1] == '\'') {
+              ++end;
+            } else {
+              ++end;
+              break;
+            }
+          }
+        }
+      } else {
+        end = std::min(rest.find(", ", pos), std::size(rest));
+      }
+      if (values.size() < static_cast<std::size_t>(*index)) {
+        values.resize(static_cast<std::size_t>(*index));
+      }
+      values[*index - 1] = rest.substr(pos, end - pos);
+      rest.remove_prefix(end);
+      if (!StartsWith(rest, ", ")) {
+        break;
+      }
+      rest.remove_prefix(2);
+    }
+  }
+
+  std::string bound;
+  bound.reserve(std::size(query));
+  bool quoted = false;
+  for (std::size_t i = 0; i < std::size(query); ++i) {
+    const auto c = query[i];
+    if (c == '\'') {
+      quoted = !quoted;
+    }
+    if (!quoted && c == '$') {
+      auto pos = i + 1;
+      const auto index = ReadNumber(query, pos, 9);
+      if (index && *index > 0 &&
+          static_cast<std::size_t>(*index) <= std::size(values) &&
+          !std::empty(values[*index - 1])) {
+        bound += values[*index - 1];
+        i = pos - 1;
+        continue;
+      }
+    }
+    bound += c;
+  }
+  return bound;
+}
+
+bool IsIdentifier(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+}  // namespace
+
+namespace tb {
+
+QueryLog::QueryLog(const std::string& path, Format format) {
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open query log " + path);
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("cannot stat query log " + path);
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+  if (size_ == 0) {
+    ::close(fd);
+    throw std::runtime_error("query log is empty " + path);
+  }
+
+  auto mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("cannot map query log " + path);
+  }
+  data_ = static_cast<const char*>(mapped);
+  ::madvise(mapped, size_, MADV_SEQUENTIAL);
+
+  switch (format) {
+    case Format::kPostgresCsv:
+      parsePostgresCsv();
+      break;
+    case Format::kMysqlGeneral:
+      parseMysqlGeneral();
+      break;
+    case Format::kMysqlSlow:
+      parseMysqlSlow();
+      break;
+  }
+  finish();
+  if (std::empty(sessions_)) {
+    throw std::runtime_error("query log has no statement " + path);
+  }
+}
+
+QueryLog::~QueryLog() {
+  if (data_) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+QueryLog::Format QueryLog::ParseFormat(std::string_view name) {
+  if (name == "postgres") {
+    return Format::kPostgresCsv;
+  }
+  if (name == "mysql_general") {
+    return Format::kMysqlGeneral;
+  }
+  if (name == "mysql_slow") {
+    return Format::kMysqlSlow;
+  }
+  throw std::runtime_error("unknown query log format: " + std::string(name));
+}
+
+QueryLog::Format QueryLog::Detect(const std::string& path) {
+  if (std::size(path) >= 4 && path.substr(std::size(path) - 4) == ".csv") {
+    return Format::kPostgresCsv;
+  }
+  std::ifstream fin(path);
+  std::string head(64 * 1024, '\0');
+  fin.read(head.data(), static_cast<std::streamsize>(std::size(head)));
+  head.resize(static_cast<std::size_t>(fin.gcount()));
+  return head.find("# Query_time:") != std::string::npos
+             ? Format::kMysqlSlow
+             : Format::kMysqlGeneral;
+}
+
+std::string QueryLog::Fingerprint(std::string_view query) {
+  std::string fingerprint;
+  fingerprint.reserve(std::size(query));
+  bool space = false;
+  const auto emit = [&fingerprint, &space](char c) {
+    if (space && !std::empty(fingerprint)) {
+      fingerprint += ' ';
+    }
+    space = false;
+    fingerprint += c;
+  };
+
+  const auto size = std::size(query);
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto c = query[i];
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      space = true;
+    } else if (c == '-' && i + 1 < size && query[i + 1] == '-') {
+      i = std::min(query.find('\n', i), size);
+      space = true;
+    } else if (c == '/' && i + 1 < size && query[i + 1] == '*') {
+      const auto end = query.find("*/", i + 2);
+      i = end == std::string_view::npos ? size : end + 1;
+      space = true;
+    } else if (c == '\'') {
+      // '' and \' do not end a literal
+      for (++i; i < size; ++i) {
+        if (query[i] == '\\') {
+          ++i;
+        } else if (query[i] == '\'') {
+          if (i + 1 < size && query[i + 1] == '\'') {
+            ++i;
+          } else {
+            break;
+          }
+        }
+      }
+      emit('?');
+    } else if ((std::isdigit(static_cast<unsigned char>(c)) ||
+                (c == '$' && i + 1 < size &&
+                 std::isdigit(static_cast<unsigned char>(query[i + 1])))) &&
+               (std::empty(fingerprint) || space ||
+                !IsIdentifier(fingerprint.back()))) {
+      for (++i; i < size && (std::isalnum(static_cast<unsigned char>(
+                                 query[i])) ||
+                             query[i] == '.');
+           ++i) {
+      }
+      --i;
+      emit('?');
+    } else {
+      emit(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+  }
+  while (!std::empty(fingerprint) &&
+         (fingerprint.back() == ';' || fingerprint.back() == ' ')) {
+    fingerprint.pop_back();
+  }
+
+  // (?, ?, ?) -> (?+)
+  std::string collapsed;
+  collapsed.reserve(std::size(fingerprint));
+  for (std::size_t i = 0; i < std::size(fingerprint); ++i) {
+    if (fingerprint[i] == '(') {
+      auto pos = i + 1;
+      const auto skip_space = [&] {
+        while (pos < std::size(fingerprint) && fingerprint[pos] == ' ') {
+          ++pos;
+        }
+      };
+      skip_space();
+      std::size_t values = 0;
+      while (pos < std::size(fingerprint) && fingerprint[pos] == '?') {
+        ++values;
+        ++pos;
+        skip_space();
+        if (pos < std::size(fingerprint) && fingerprint[pos] == ',') {
+          ++pos;
+          skip_space();
+        } else {
+          break;
+        }
+      }
+      if (values > 1 && pos < std::size(fingerprint) &&
+          fingerprint[pos] == ')') {
+        collapsed += "(?+)";
+        i = pos;
+        continue;
+      }
+    }
+    collapsed += fingerprint[i];
+  }
+  return collapsed;
+}
+
+std::size_t QueryLog::statements() const noexcept {
+  std::size_t count = 0;
+  for (const auto& session : sessions_) {
+    count += std::size(session.statements);
+  }
+  return count;
+}
+
+// statements logged with log_statement = all or with
+// log_min_duration_statement, extended protocol executions are bound with
+// the parameters of their detail
+void QueryLog::parsePostgresCsv() {
+  constexpr std::size_t kLogTime = 0, kSessionId = 5, kSeverity = 11,
+                        kMessage = 13, kDetail = 14;
+  const std::string_view data(data_, size_);
+  std::vector<std::string_view> fields;
+  for (std::size_t offset = 0; offset < size_;) {
+    offset = ReadCsvRecord(data, offset, fields);
+    if (std::size(fields) <= kDetail || fields[kSeverity] != "LOG") {
+      continue;
+    }
+    auto time = ParseTime(fields[kLogTime]);
+    if (!time) {
+      continue;
+    }
+
+    auto message = fields[kMessage];
+    // logged when the statement finished
+    if (StartsWith(message, "duration: ")) {
+      const auto separator = message.find("  ");
+      if (separator == std::string_view::npos) {
+        continue;
+      }
+      *time -= ParseDuration(message.substr(10, separator - 10), 1e6);
+      message.remove_prefix(separator + 2);
+    }
+
+    std::string_view query;
+    if (StartsWith(message, "statement: ")) {
+      message.remove_prefix(11);
+      query = message.find("\"\"") == std::string_view::npos
+                  ? message
+                  : rewrite(Unescape(message));
+    } else if (StartsWith(message, "execute ")) {
+      const auto colon = message.find(": ");
+      if (colon == std::string_view::npos) {
+        continue;
+      }
+      message.remove_prefix(colon + 2);
+      query = rewrite(
+          BindParameters(Unescape(message), Unescape(fields[kDetail])));
+    } else {
+      continue;
+    }
+    add(fields[kSessionId], *time, query);
+  }
+}
+
+// "2024-01-02T03:04:05.678901Z\t   12 Query\tSELECT 1", statements may
+// continue on the following lines
+void QueryLog::parseMysqlGeneral() {
+  const std::string_view data(data_, size_);
+  std::int64_t time = 0;
+  Statement* last = nullptr;
+  for (std::size_t offset = 0; offset < size_;) {
+    auto end = data.find('\n', offset);
+    if (end == std::string_view::npos) {
+      end = size_;
+    }
+    const auto line = TrimRight(data.substr(offset, end - offset), "\r");
+    offset = end + 1;
+
+    const auto extend = [&last, &line] {
+      if (last != nullptr && !std::empty(line)) {
+        last->query = std::string_view(
+            last->query.data(),
+            static_cast<std::size_t>(line.data() + std::size(line) -
+                                     last->query.data()));
+      }
+    };
+
+    // 5.6 leaves the time out for statements within the same second
+    const auto tab = line.find('\t');
+    if (tab == std::string_view::npos) {
+      extend();
+      continue;
+    }
+    auto pos = line.find_first_not_of("\t ", tab);
+    const auto id_begin = pos;
+    if (pos == std::string_view::npos || !ReadNumber(line, pos, 20) ||
+        pos >= std::size(line) || line[pos] != ' ') {
+      extend();
+      continue;
+    }
+    const auto id = line.substr(id_begin, pos - id_begin);
+    const auto command_end = std::min(line.find('\t', pos), std::size(line));
+    const auto command = line.substr(pos + 1, command_end - pos - 1);
+    const auto argument =
+        line.substr(std::min(command_end + 1, std::size(line)));
+    if (tab > 0) {
+      const auto parsed = ParseTime(line.substr(0, tab));
+      if (!parsed) {
+        extend();
+        continue;
+      }
+      time = *parsed;
+    }
+
+    last = nullptr;
+    if ((command == "Query" || command == "Execute") && !std::empty(argument)) {
+      last = &add(id, time, argument);
+    } else if (command == "Init DB") {
+      add(id, time, rewrite("USE `" + std::string(argument) + "`"));
+    }
+  }
+}
+
+// entries of "# Time:", "# User@Host: ... Id: 12" and "# Query_time:"
+// headers followed by the statement. the time is when it finished.
+void QueryLog::parseMysqlSlow() {
+  const std::string_view data(data_, size_);
+  std::int64_t time = 0, query_time = 0;
+  std::string_view id;
+  bool in_entry = false;
+  const char* body_begin = nullptr;
+  const char* body_end = nullptr;
+
+  const auto flush = [&] {
+    if (body_begin != nullptr) {
+      const auto query = TrimRight(
+          std::string_view(body_begin,
+                           static_cast<std::size_t>(body_end - body_begin)),
+          " \t\r\n;");
+      if (!std::empty(query)) {
+        add(id, time - query_time, query);
+      }
+    }
+    body_begin = body_end = nullptr;
+    in_entry = false;
+  };
+
+  for (std::size_t offset = 0; offset < size_;) {
+    auto end = data.find('\n', offset);
+    if (end == std::string_view::npos) {
+      end = size_;
+    }
+    const auto line = TrimRight(data.substr(offset, end - offset), "\r");
+    offset = end + 1;
+
+    if (StartsWith(line, "#")) {
+      flush();
+      if (StartsWith(line, "# Time: ")) {
+        time = ParseTime(line.substr(8)).value_or(time);
+      } else if (StartsWith(line, "# User@Host: ")) {
+        const auto id_pos = line.find("Id:");
+        if (id_pos != std::string_view::npos) {
+          const auto begin = line.find_first_not_of(' ', id_pos + 3);
+          id = begin == std::string_view::npos
+                   ? std::string_view()
+                   : line.substr(begin, line.find(' ', begin) - begin);
+        }
+      } else if (StartsWith(line, "# Query_time: ")) {
+        const auto value = line.substr(14, line.find(' ', 14) - 14);
+        query_time = ParseDuration(value, 1e9);
+        in_entry = true;
+      }
+      continue;
+    }
+    if (!in_entry) {
+      continue;
+    }
+    if (body_begin == nullptr) {
+      if (StartsWith(line, "SET timestamp=")) {
+        continue;
+      }
+      if (StartsWith(line, "use ")) {
+        add(id, time - query_time, TrimRight(line, ";"));
+        continue;
+      }
+      body_begin = line.data();
+    }
+    body_end = line.data() + std::size(line);
+  }
+  flush();
+}
+
+QueryLog::Statement& QueryLog::add(std::string_view session,
+                                   std::int64_t time, std::string_view query) {
+  const auto [it, inserted] =
+      session_index_.try_emplace(std::string(session), std::size(sessions_));
+  if (inserted) {
+    sessions_.push_back({std::string(session), {}});
+  }
+  return sessions_[it->second].statements.emplace_back(
+      Statement{time, 0, query});
+}
+
+std::string_view QueryLog::rewrite(std::string query) {
+  return rewritten_.emplace_back(std::move(query));
+}
+
+void QueryLog::finish() {
+  session_index_.clear();
+  sessions_.erase(std::remove_if(std::begin(sessions_), std::end(sessions_),
+                                 [](const Session& session) {
+                                   return std::empty(session.statements);
+                                 }),
+                  std::end(sessions_));
+
+  auto first = std::numeric_limits<std::int64_t>::max();
+  for (auto& session : sessions_) {
+    std::stable_sort(std::begin(session.statements),
+                     std::end(session.statements),
+                     [](const Statement& a, const Statement& b) {
+                       return a.time < b.time;
+                     });
+    first = std::min(first, session.statements.front().time);
+  }
+  std::stable_sort(std::begin(sessions_), std::end(sessions_),
+                   [](const Session& a, const Session& b) {
+                     return a.statements.front().time <
+                            b.statements.front().time;
+                   });
+
+  std::unordered_map<std::string, std::size_t> fingerprint_index;
+  for (auto& session : sessions_) {
+    for (auto& statement : session.statements) {
+      statement.time -= first;
+      auto fingerprint = Fingerprint(statement.query);
+      const auto [it, inserted] = fingerprint_index.try_emplace(
+          fingerprint, std::size(fingerprints_));
+      if (inserted) {
+        fingerprints_.emplace_back(std::move(fingerprint));
+      }
+      statement.fingerprint = it->second;
+    }
+  }
+}
+
+}  // namespace tb
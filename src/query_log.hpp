@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace tb {
+
+// statements of a captured query log grouped by session in the order they
+// were issued. the file is memory mapped and read in one pass, statements
+// are views into the mapping unless they had to be rewritten.
+class QueryLog {
+ public:
+  enum class Format {
+    kPostgresCsv,
+    kMysqlGeneral,
+    kMysqlSlow,
+  };
+
+  struct Statement {
+    // nanoseconds since the first statement of the log
+    std::int64_t time;
+    std::size_t fingerprint;
+    std::string_view query;
+  };
+
+  struct Session {
+    std::string id;
+    std::vector<Statement> statements;
+  };
+
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::vector<Session> sessions_;
+  std::vector<std::string> fingerprints_;
+  // statements which are not verbatim in the file
+  std::deque<std::string> rewritten_;
+  std::unordered_map<std::string, std::size_t> session_index_;
+
+ public:
+  QueryLog(const std::string& path, Format format);
+
+  QueryLog(const QueryLog&) = delete;
+  QueryLog(QueryLog&&) = delete;
+
+  QueryLog& operator=(const QueryLog&) = delete;
+  QueryLog& operator=(QueryLog&&) = delete;
+
+  ~QueryLog();
+
+ public:
+  // postgres, mysql_general or mysql_slow
+  static Format ParseFormat(std::string_view name);
+  // csvlog by extension, slow or general log by content
+  static Format Detect(const std::string& path);
+
+  // statement with literals and parameters replaced by ?, lists of them
+  // collapsed to ?+ and whitespace and case normalized
+  static std::string Fingerprint(std::string_view query);
+
+ public:
+  // ordered by their first statement
+  [[nodiscard]] const std::vector<Session>& sessions() const noexcept {
+    return sessions_;
+  }
+
+  [[nodiscard]] const std::vector<std::string>& fingerprints() const noexcept {
+    return fingerprints_;
+  }
+
+  [[nodiscard]] std::size_t statements() const noexcept;
+
+ private:
+  void parsePostgresCsv();
+  void parseMysqlGeneral();
+  void parseMysqlSlow();
+
+  Statement& add(std::string_view session, std::int64_t time,
+                 std::string_view query);
+  std::string_view rewrite(std::string query);
+  void finish();
+};
+
+}  // namespace tb
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+namespace tb {
+
+// paces one worker to a fixed schedule of transaction start times
+class RateLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+ private:
+  Clock::duration interval_;
+  Clock::time_point next_;
+
+ public:
+  RateLimiter() : interval_(Clock::duration::zero()) {}
+
+  // rate: transactions per second of this worker, 0 means unlimited
+  explicit RateLimiter(double rate) : interval_(Interval(rate)) {}
+
+ public:
+  [[nodiscard]] bool limited() const noexcept {
+    return interval_ != Clock::duration::zero();
+  }
+
+  void start() { next_ = Clock::now(); }
+
+  // paces the following starts to rate, a schedule which was unlimited
+  // starts now
+  void rate(double rate) {
+    const auto interval = Interval(rate);
+    if (!limited()) {
+      next_ = Clock::now();
+    }
+    interval_ = interval;
+  }
+
+  // shifts the schedule, e.g. by think time which is not part of the latency
+  template <class Duration>
+  void postpone(const Duration& duration) {
+    next_ += std::chrono::duration_cast<Clock::duration>(duration);
+  }
+
+  // waits for the next scheduled start and returns how late it is served.
+  // the lateness is added to the latency to avoid coordinated omission.
+  Clock::duration wait() {
+    if (!limited()) {
+      return Clock::duration::zero();
+    }
+    const auto scheduled = next_;
+    next_ += interval_;
+
+    const auto now = Clock::now();
+    if (now < scheduled) {
+      std::this_thread::sleep_until(scheduled);
+      return Clock::duration::zero();
+    }
+    return now - scheduled;
+  }
+
+ private:
+  static Clock::duration Interval(double rate) {
+    return rate > 0 ? std::chrono::duration_cast<Clock::duration>(
+                          std::chrono::duration<double>(1.0 / rate))
+                    : Clock::duration::zero();
+  }
+};
+
+}  // namespace tb
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <configuration.hpp>
+#include <cstdlib>
+#include <numeric>
+#include <ostream>
+#include <properties.hpp>
+#include <statistics.hpp>
+#include <string>
+#include <vector>
+
+#include "executor.hpp"
+
+namespace tb {
+
+class RepeatResult {
+ public:
+  inline static constexpr std::array<const char*, 6> kMetrics = {
+      "throughput", "average", "median", "p90", "p99", "p999"};
+
+  struct Trial {
+    // in the order of kMetrics, latencies in nanoseconds
+    std::array<double, std::size(kMetrics)> values;
+    std::size_t success, error;
+  };
+
+  struct Summary {
+    double mean, stddev, lower, upper;
+  };
+
+ private:
+  // modified z-score above which a trial is an outlier (Iglewicz and Hoaglin)
+  inline static constexpr double kOutlierScore = 3.5;
+
+  std::string name_;
+  std::vector<Trial> trials_;
+
+ public:
+  RepeatResult(std::string name, std::vector<Trial> trials)
+      : name_(std::move(name)), trials_(std::move(trials)) {}
+
+ public:
+  [[nodiscard]] const std::vector<Trial>& trials() const noexcept {
+    return trials_;
+  }
+
+  // mean, sample standard deviation and 95% confidence interval of the mean
+  [[nodiscard]] Summary summary(std::size_t metric) const {
+    const auto values = column(metric);
+    const auto n = static_cast<double>(std::size(values));
+    const auto mean =
+        std::accumulate(std::begin(values), std::end(values), 0.0) / n;
+    if (std::size(values) < 2) {
+      return {mean, 0.0, mean, mean};
+    }
+
+    double square_sum = 0.0;
+    for (const auto value : values) {
+      square_sum += (value - mean) * (value - mean);
+    }
+    const auto stddev = std::sqrt(square_sum / (n - 1));
+    const auto half_width =
+        StudentT975(std::size(values) - 1) * stddev / std::sqrt(n);
+    return {mean, stddev, mean - half_width, mean + half_width};
+  }
+
+  // metrics of a trial lying far from the other trials
+  [[nodiscard]] std::vector<std::size_t> outliers(std::size_t trial) const {
+    std::vector<std::size_t> metrics;
+    if (std::size(trials_) < 3) {
+      return metrics;
+    }
+    for (std::size_t m = 0; m < std::size(kMetrics); ++m) {
+      const auto values = column(m);
+      const auto median = Median(values);
+
+      std::vector<double> deviations(std::size(values));
+      std::transform(std::begin(values), std::end(values),
+                     std::begin(deviations),
+                     [median](double v) { return std::abs(v - median); });
+      // MAD is 0 when most trials agree, the mean deviation is used then
+      auto scale = 1.4826 * Median(deviations);
+      if (scale == 0.0) {
+        scale = 1.253314 *
+                std::accumulate(std::begin(deviations), std::end(deviations),
+                                0.0) /
+                static_cast<double>(std::size(deviations));
+      }
+      if (scale > 0.0 && deviations[trial] / scale > kOutlierScore) {
+        metrics.emplace_back(m);
+      }
+    }
+    return metrics;
+  }
+
+  void dump(std::ostream& os) const {
+    os << std::dec;
+    os << "name: " << name_ << "\n"
+       << "mode: repeat\n"
+       << "unit: ns\n"
+       << "trials:\n";
+    for (std::size_t t = 0; t < std::size(trials_); ++t) {
+      const auto& trial = trials_[t];
+      os << "  - {trial: " << t + 1;
+      for (std::size_t m = 0; m < std::size(kMetrics); ++m) {
+        os << ", " << kMetrics[m] << ": " << trial.values[m];
+      }
+      os << ", success: " << trial.success << ", error: " << trial.error
+         << ", outlier: [";
+      const auto metrics = outliers(t);
+      for (std::size_t i = 0; i < std::size(metrics); ++i) {
+        os << (i == 0 ? "" : ", ") << kMetrics[metrics[i]];
+      }
+      os << "]}\n";
+    }
+
+    os << "summary:\n";
+    for (std::size_t m = 0; m < std::size(kMetrics); ++m) {
+      const auto s = summary(m);
+      os << "  " << kMetrics[m] << ": {mean: " << s.mean
+         << ", stddev: " << s.stddev << ", ci95_lower: " << s.lower
+         << ", ci95_upper: " << s.upper << "}\n";
+    }
+
+    os << "outliers: [";
+    bool first = true;
+    for (std::size_t t = 0; t < std::size(trials_); ++t) {
+      if (!std::empty(outliers(t))) {
+        os << (first ? "" : ", ") << t + 1;
+        first = false;
+      }
+    }
+    os << "]\n";
+  }
+
+ private:
+  [[nodiscard]] std::vector<double> column(std::size_t metric) const {
+    std::vector<double> values(std::size(trials_));
+    std::transform(std::begin(trials_), std::end(trials_), std::begin(values),
+                   [metric](const Trial& t) { return t.values[metric]; });
+    return values;
+  }
+
+  static double Median(std::vector<double> values) {
+    std::sort(std::begin(values), std::end(values));
+    const auto size = std::size(values);
+    return size % 2 == 1 ? values[size / 2]
+                         : (values[size / 2 - 1] + values[size / 2]) / 2;
+  }
+
+  // two sided 95% quantile of Student's t distribution
+  static double StudentT975(std::size_t degrees_of_freedom) {
+    static constexpr std::array<double, 30> kTable = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+        2.262,  2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+        2.110,  2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+        2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+    if (degrees_of_freedom == 0) {
+      return 0.0;
+    }
+    if (degrees_of_freedom <= std::size(kTable)) {
+      return kTable[degrees_of_freedom - 1];
+    }
+    return 1.96;
+  }
+};
+
+class Repeater {
+ private:
+  Executor& executor_;
+
+ public:
+  explicit Repeater(Executor& executor) : executor_(executor) {}
+
+ public:
+  RepeatResult repeat(const Configuration& config, const Properties& props) {
+    if (!config.repeat()) {
+      throw std::runtime_error("repeat setting is not provided");
+    }
+    const auto& setting = *config.repeat();
+
+    std::vector<RepeatResult::Trial> trials;
+    for (std::size_t t = 0; t < setting.trials; ++t) {
+      reset(setting, props);
+      const auto stat = executor_.execute(config, props);
+
+      trials.push_back(
+          {{stat.throughput(), static_cast<double>(stat.average().count()),
+            static_cast<double>(stat.median().count()),
+            static_cast<double>(stat.percentile(90).count()),
+            static_cast<double>(stat.percentile(99).count()),
+            static_cast<double>(stat.percentile(99.9).count())},
+           stat.wholeCount<Statistics::kSuccessIndex>(),
+           stat.wholeCount<Statistics::kErrorIndex>()});
+      std::cerr << "repeat: trial=" << t + 1
+                << " throughput=" << stat.throughput() << std::endl;
+    }
+
+    return RepeatResult(config.name(), std::move(trials));
+  }
+
+ private:
+  void reset(const RepeatSetting& setting, const Properties& props) {
+    if (!std::empty(setting.reset_queries)) {
+      auto db = executor_.create(props);
+      for (const auto& query : setting.reset_queries) {
+        db->execute(query);
+      }
+    }
+    if (!std::empty(setting.reset_command) &&
+        std::system(setting.reset_command.c_str()) != 0) {
+      throw std::runtime_error("reset command failed: " +
+                               setting.reset_command);
+    }
+  }
+};
+
+}  // namespace tb
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <database.hpp>
+#include <future>
+#include <iostream>
+#include <numeric>
+#include <ostream>
+#include <properties.hpp>
+#include <queue>
+#include <statistics.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clock.hpp"
+#include "executor.hpp"
+#include "query_log.hpp"
+
+namespace tb {
+
+class ReplayResult {
+ private:
+  Statistics statistics_;
+  // one per fingerprint of the log, named by it
+  std::vector<TransactionTypeStatistics> fingerprints_;
+  std::size_t sessions_;
+  double speed_;
+  // how late statements were sent against the schedule of the log
+  Statistics::ElapsedTimeType lag_average_, lag_max_;
+
+ public:
+  ReplayResult(Statistics statistics,
+               std::vector<TransactionTypeStatistics> fingerprints,
+               std::size_t sessions, double speed,
+               Statistics::ElapsedTimeType lag_average,
+               Statistics::ElapsedTimeType lag_max)
+      : statistics_(std::move(statistics)),
+        fingerprints_(std::move(fingerprints)),
+        sessions_(sessions),
+        speed_(speed),
+        lag_average_(lag_average),
+        lag_max_(lag_max) {}
+
+ public:
+  [[nodiscard]] const Statistics& statistics() const noexcept {
+    return statistics_;
+  }
+
+  // fingerprints by the time spent in them, most first
+  void dump(std::ostream& os) const {
+    statistics_.dump(os);
+
+    os << std::dec;
+    os << "replay:\n"
+       << "  speed: " << speed_ << "\n"
+       << "  sessions: " << sessions_ << "\n"
+       << "  connections: " << statistics_.threadCount() << "\n"
+       << "  lag:\n"
+       << "    average: " << lag_average_.count() << "\n"
+       << "    max: " << lag_max_.count() << "\n";
+
+    std::vector<std::pair<Statistics::ElapsedTimeType,
+                          const TransactionTypeStatistics*>>
+        ordered;
+    for (const auto& fingerprint : fingerprints_) {
+      ordered.emplace_back(
+          std::accumulate(std::begin(fingerprint.latencies),
+                          std::end(fingerprint.latencies),
+                          Statistics::ElapsedTimeType(0)),
+          &fingerprint);
+    }
+    std::stable_sort(
+        std::begin(ordered), std::end(ordered),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    os << "fingerprints:\n";
+    for (const auto& [total, fingerprint] : ordered) {
+      auto latencies = fingerprint->latencies;
+      std::sort(std::begin(latencies), std::end(latencies));
+      const auto count = std::size(latencies);
+      const auto at = [&latencies, count](double p) {
+        if (count == 0) {
+          return std::int64_t(0);
+        }
+        const auto rank = static_cast<std::size_t>(
+            std::ceil(p / 100.0 * static_cast<double>(count)));
+        return latencies[std::clamp<std::size_t>(rank, 1, count) - 1].count();
+      };
+      os << "  - {fingerprint: " << Quote(fingerprint->name)
+         << ", count: " << count << ", error: " << fingerprint->errors
+         << ", total: " << total.count()
+         << ", average: " << (count == 0 ? 0 : (total / count).count())
+         << ", median: " << at(50) << ", p99: " << at(99)
+         << ", max: " << at(100) << "}\n";
+    }
+  }
+
+ private:
+  static std::string Quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (const auto c : text) {
+      if (c == '"' || c == '\\') {
+        quoted += '\\';
+      }
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+};
+
+// sends the statements of a query log through connections of a backend,
+// one connection per concurrently open session unless capped
+class Replayer {
+ private:
+  Executor& executor_;
+
+  struct Worker {
+    std::vector<const QueryLog::Session*> sessions;
+    Statistics::ElapsedTimesType success, error;
+    std::vector<TransactionTypeStatistics> fingerprints;
+    Statistics::ElapsedTimeType lag_sum{0}, lag_max{0};
+  };
+
+ public:
+  explicit Replayer(Executor& executor) : executor_(executor) {}
+
+ public:
+  // speed scales the time between statements, 0 sends them back to back
+  ReplayResult replay(const QueryLog& log, const std::string& name,
+                      const Properties& props, double speed,
+                      std::size_t max_connections) {
+    auto workers = Assign(log, max_connections);
+    for (auto& worker : workers) {
+      worker.fingerprints.resize(std::size(log.fingerprints()));
+    }
+
+    std::atomic<std::size_t> connected(0);
+    std::promise<Clock::time_point> start_promise;
+    const auto start = start_promise.get_future().share();
+    std::vector<std::future<void>> futures;
+    for (auto& worker : workers) {
+      futures.emplace_back(std::async(std::launch::async, [&, start] {
+        run(worker, props, speed, connected, start);
+      }));
+    }
+    while (connected < std::size(workers)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    const auto begin = Clock::now();
+    start_promise.set_value(begin);
+    for (auto& future : futures) {
+      future.get();
+    }
+    const auto duration = Clock::now() - begin;
+
+    std::vector<Statistics::ElapsedTImesPerThreadType> elapsed_times;
+    std::vector<TransactionTypeStatistics> fingerprints(
+        std::size(log.fingerprints()));
+    for (std::size_t f = 0; f < std::size(fingerprints); ++f) {
+      fingerprints[f].name = log.fingerprints()[f];
+    }
+    Statistics::ElapsedTimeType lag_sum(0), lag_max(0);
+    std::size_t statements = 0;
+    for (auto& worker : workers) {
+      statements += std::size(worker.success) + std::size(worker.error);
+      elapsed_times.emplace_back(std::move(worker.success),
+                                 std::move(worker.error));
+      for (std::size_t f = 0; f < std::size(fingerprints); ++f) {
+        fingerprints[f].merge(worker.fingerprints[f]);
+      }
+      lag_sum += worker.lag_sum;
+      lag_max = std::max(lag_max, worker.lag_max);
+    }
+
+    Statistics statistics(name, std::size(workers), std::move(elapsed_times),
+                          duration);
+    statistics.timer(std::string(Clock::ToString(Clock::source())),
+                     Clock::Overhead());
+    return ReplayResult(
+        std::move(statistics), std::move(fingerprints),
+        std::size(log.sessions()), speed,
+        statements == 0 ? Statistics::ElapsedTimeType(0)
+                        : lag_sum / static_cast<std::int64_t>(statements),
+        lag_max);
+  }
+
+ private:
+  // sessions in order of their first statement go to the connection which
+  // became free first, a new one is opened while none is free
+  static std::vector<Worker> Assign(const QueryLog& log,
+                                    std::size_t max_connections) {
+    using Free = std::pair<std::int64_t, std::size_t>;
+    std::priority_queue<Free, std::vector<Free>, std::greater<>> free;
+    std::vector<Worker> workers;
+    for (const auto& session : log.sessions()) {
+      const auto first = session.statements.front().time;
+      const auto last = session.statements.back().time;
+
+      std::size_t worker;
+      auto end = last;
+      if (!std::empty(free) &&
+          (free.top().first <= first ||
+           (max_connections > 0 && std::size(workers) >= max_connections))) {
+        worker = free.top().second;
+        end = std::max(end, free.top().first);
+        free.pop();
+      } else {
+        worker = std::size(workers);
+        workers.emplace_back();
+      }
+      workers[worker].sessions.emplace_back(&session);
+      free.emplace(end, worker);
+    }
+    return workers;
+  }
+
+  void run(Worker& worker, const Properties& props, double speed,
+           std::atomic<std::size_t>& connected,
+           const std::shared_future<Clock::time_point>& start) {
+    std::unique_ptr<database::Database> db;
+    try {
+      db = executor_.create(props);
+    } catch (const std::exception& e) {
+      std::cerr << "error: " << e.what() << std::endl;
+    }
+    connected++;
+    const auto begin = start.get();
+
+    for (const auto* session : worker.sessions) {
+      for (const auto& statement : session->statements) {
+        if (speed > 0.0) {
+          const auto scheduled =
+              begin + std::chrono::nanoseconds(static_cast<std::int64_t>(
+                          static_cast<double>(statement.time) / speed));
+          std::this_thread::sleep_until(scheduled);
+          const auto lag = Clock::now() - scheduled;
+          worker.lag_sum += lag;
+          worker.lag_max = std::max(worker.lag_max, lag);
+        }
+
+        bool is_success = db != nullptr;
+        const auto statement_begin = Clock::now();
+        if (db) {
+          try {
+            db->execute(statement.query);
+          } catch (...) {
+            is_success = false;
+          }
+        }
+        const auto latency = Clock::now() - statement_begin;
+
+        auto& fingerprint = worker.fingerprints[statement.fingerprint];
+        if (is_success) {
+          worker.success.emplace_back(latency);
+          fingerprint.latencies.emplace_back(latency);
+          ++fingerprint.commits;
+        } else {
+          worker.error.emplace_back(latency);
+          ++fingerprint.errors;
+        }
+      }
+    }
+  }
+};
+
+}  // namespace tb
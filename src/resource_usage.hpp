@@ -0,0 +1,151 @@
+#pragma once
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <statistics.hpp>
+
+namespace tb {
+
+// cpu time and context switches of the calling thread
+class ThreadUsage {
+ private:
+  rusage begin_{};
+
+ public:
+  void start() { Get(begin_); }
+
+  void stop(ClientUsage& usage) const {
+    rusage end{};
+    Get(end);
+    usage.cpu_time = ToMicroseconds(end.ru_utime) +
+                     ToMicroseconds(end.ru_stime) -
+                     ToMicroseconds(begin_.ru_utime) -
+                     ToMicroseconds(begin_.ru_stime);
+    usage.voluntary_switches = end.ru_nvcsw - begin_.ru_nvcsw;
+    usage.involuntary_switches = end.ru_nivcsw - begin_.ru_nivcsw;
+  }
+
+ private:
+  static void Get(rusage& usage) {
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, &usage);
+#else
+    getrusage(RUSAGE_SELF, &usage);
+#endif
+  }
+
+  static std::chrono::microseconds ToMicroseconds(const timeval& tv) {
+    return std::chrono::seconds(tv.tv_sec) +
+           std::chrono::microseconds(tv.tv_usec);
+  }
+};
+
+// user space cycles, instructions and cache misses of the calling thread
+class PerfCounters {
+ private:
+  int leader_ = -1;
+  std::array<int, 2> members_{-1, -1};
+
+ public:
+  PerfCounters() = default;
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters(PerfCounters&&) = delete;
+
+  PerfCounters& operator=(const PerfCounters&) = delete;
+  PerfCounters& operator=(PerfCounters&&) = delete;
+
+  ~PerfCounters() { close(); }
+
+ public:
+  // false when the kernel does not allow counting (e.g. perf_event_paranoid)
+  bool open() {
+#ifdef __linux__
+    leader_ = Open(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (leader_ < 0) {
+      return false;
+    }
+    members_[0] = Open(PERF_COUNT_HW_INSTRUCTIONS, leader_);
+    members_[1] = Open(PERF_COUNT_HW_CACHE_MISSES, leader_);
+    if (members_[0] < 0 || members_[1] < 0) {
+      close();
+      return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void start() {
+#ifdef __linux__
+    if (leader_ >= 0) {
+      ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+  }
+
+  void stop(ClientUsage& usage) {
+#ifdef __linux__
+    if (leader_ < 0) {
+      return;
+    }
+    ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // PERF_FORMAT_GROUP: number of events followed by their values
+    std::array<std::uint64_t, 4> values{};
+    if (read(leader_, values.data(), sizeof(values)) !=
+        static_cast<ssize_t>(sizeof(values))) {
+      return;
+    }
+    usage.perf = ClientUsage::Perf{values[1], values[2], values[3]};
+#else
+    static_cast<void>(usage);
+#endif
+  }
+
+ private:
+  void close() {
+    for (auto& fd : members_) {
+      if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    if (leader_ >= 0) {
+      ::close(leader_);
+      leader_ = -1;
+    }
+  }
+
+#ifdef __linux__
+  static int Open(std::uint64_t config, int group) {
+    perf_event_attr attr{};
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+  }
+#endif
+};
+
+}  // namespace tb
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <configuration.hpp>
+#include <optional>
+#include <properties.hpp>
+#include <statistics.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tb {
+
+// targets of a properties file and the rule which sends every transaction
+// to one of them. a file without targets is a single primary target.
+class Router {
+ public:
+  struct Target {
+    std::string name;
+    Properties properties;
+    bool replica;
+  };
+
+  // round robin positions of one worker
+  struct Cursor {
+    std::size_t primary = 0, replica = 0;
+  };
+
+ private:
+  std::vector<Target> targets_;
+  std::vector<std::size_t> primaries_, replicas_;
+  bool read_only_to_replicas_;
+  // slot of the shard variable in each transaction type
+  std::vector<std::optional<std::size_t>> shard_slots_;
+
+ public:
+  Router(const Configuration& config, const Properties& props)
+      : read_only_to_replicas_(config.routing().read_only_to_replicas) {
+    for (const auto& name : props.targets()) {
+      auto properties = props.target(name);
+      const auto role = properties.getProperty("role", "primary");
+      if (role != "primary" && role != "replica") {
+        throw std::runtime_error("unknown role of target " + name + ": " +
+                                 role);
+      }
+      (role == "replica" ? replicas_ : primaries_)
+          .emplace_back(std::size(targets_));
+      targets_.push_back({name, std::move(properties), role == "replica"});
+    }
+    if (std::empty(targets_)) {
+      primaries_.emplace_back(0);
+      targets_.push_back({"default", props, false});
+    }
+    if (std::empty(primaries_)) {
+      throw std::runtime_error("properties have no primary target");
+    }
+
+    const auto& shard_by = config.routing().shard_by;
+    for (const auto& transaction : config.transactions()) {
+      shard_slots_.emplace_back(
+          std::empty(shard_by) ? std::nullopt
+                               : transaction.symbols.find(shard_by));
+    }
+  }
+
+ public:
+  [[nodiscard]] const std::vector<Target>& targets() const noexcept {
+    return targets_;
+  }
+
+  // statistics named after the targets, nothing for a single target
+  [[nodiscard]] std::vector<TargetStatistics> statistics() const {
+    std::vector<TargetStatistics> statistics;
+    if (std::size(targets_) > 1) {
+      for (const auto& target : targets_) {
+        auto& s = statistics.emplace_back();
+        s.name = target.name;
+        s.role = target.replica ? "replica" : "primary";
+      }
+    }
+    return statistics;
+  }
+
+  // target of the last transaction of generator
+  [[nodiscard]] std::size_t route(const TransactionGenerator& generator,
+                                  Cursor& cursor) const {
+    if (read_only_to_replicas_ && !std::empty(replicas_) &&
+        generator.setting().control.options.read_only) {
+      return replicas_[cursor.replica++ % std::size(replicas_)];
+    }
+    if (std::size(primaries_) == 1) {
+      return primaries_.front();
+    }
+    if (const auto& slot = shard_slots_[generator.type()]) {
+      return primaries_[Shard(generator.variable(*slot)) %
+                        std::size(primaries_)];
+    }
+    return primaries_[cursor.primary++ % std::size(primaries_)];
+  }
+
+ private:
+  // numbers map to shard value % shards like most applications do, other
+  // values by FNV-1a of their text
+  static std::uint64_t Shard(const te::Value& value) {
+    if (value.index() == te::kNumberIndex) {
+      const auto number = std::get<te::kNumberIndex>(value);
+      // negated as unsigned, -number overflows for the smallest one
+      const auto bits = static_cast<std::uint64_t>(number);
+      return number < 0 ? 0 - bits : bits;
+    }
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const auto c : te::AsString(value)) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+};
+
+}  // namespace tb
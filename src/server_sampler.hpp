@@ -0,0 +1,164 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <database.hpp>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <statistics.hpp>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "clock.hpp"
+#include "live_metrics.hpp"
+
+namespace tb {
+
+// reads the server metrics of a backend through a connection of its own
+// every interval while a benchmark runs, together with the client counters
+// of the same moment, so both sides are on the clock of the latencies.
+class ServerSampler {
+ private:
+  std::unique_ptr<database::Database> db_;
+  const LiveMetrics& metrics_;
+  std::chrono::nanoseconds interval_;
+  Clock::time_point start_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable stop_signal_;
+  bool stop_ = false;
+  // the server is not asked again once it failed
+  bool failed_ = false;
+
+  ServerMetricsSeries series_;
+  std::unordered_map<std::string, std::size_t> columns_;
+  // last value of each counter
+  std::vector<std::optional<double>> previous_;
+  LiveMetrics::Totals previous_totals_;
+
+ public:
+  // reads the values the first interval is measured from
+  ServerSampler(std::unique_ptr<database::Database> db,
+                const LiveMetrics& metrics, std::chrono::nanoseconds interval)
+      : db_(std::move(db)), metrics_(metrics), interval_(interval) {
+    sample();
+  }
+
+  ServerSampler(const ServerSampler&) = delete;
+  ServerSampler& operator=(const ServerSampler&) = delete;
+
+  ~ServerSampler() { stop(); }
+
+ public:
+  void start(Clock::time_point start) {
+    start_ = start;
+    series_.samples.clear();
+    thread_ = std::thread([this] { run(); });
+  }
+
+  // ends sampling with a last, usually shorter interval
+  ServerMetricsSeries stop() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    stop_signal_.notify_all();
+    if (!thread_.joinable()) {
+      return {};
+    }
+    thread_.join();
+    sample();
+    return std::move(series_);
+  }
+
+ private:
+  void run() {
+    auto next = std::chrono::steady_clock::now() + interval_;
+    std::unique_lock lock(mutex_);
+    while (!stop_signal_.wait_until(lock, next, [this] { return stop_; })) {
+      lock.unlock();
+      sample();
+      lock.lock();
+      next += interval_;
+    }
+  }
+
+  void sample() {
+    std::vector<database::ServerMetric> server;
+    const auto begin = Clock::now();
+    if (!failed_) {
+      try {
+        server = db_->serverMetrics();
+      } catch (const std::exception& e) {
+        failed_ = true;
+        std::cerr << "warning: server metrics cannot be read: " << e.what()
+                  << std::endl;
+      }
+    }
+    const auto totals = metrics_.totals();
+    // the middle of the round trip to the server
+    const auto time = begin + (Clock::now() - begin) / 2;
+
+    auto& sample = series_.samples.emplace_back();
+    sample.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        time - start_);
+    for (const auto& metric : server) {
+      const auto [column, added] =
+          columns_.try_emplace(metric.name, std::size(series_.names));
+      if (added) {
+        series_.names.emplace_back(metric.name);
+        previous_.emplace_back();
+      }
+      const auto index = column->second;
+      if (std::size(sample.server) <= index) {
+        sample.server.resize(index + 1);
+      }
+      if (!metric.counter) {
+        sample.server[index] = metric.value;
+        continue;
+      }
+      if (previous_[index]) {
+        sample.server[index] = metric.value - *previous_[index];
+      }
+      previous_[index] = metric.value;
+    }
+    Client(previous_totals_, totals, sample);
+    previous_totals_ = totals;
+  }
+
+  // transactions which completed since the previous sample
+  static void Client(const LiveMetrics::Totals& from,
+                     const LiveMetrics::Totals& to, MetricsSample& sample) {
+    sample.success = to.success - from.success;
+    sample.errors = to.errors - from.errors;
+    std::uint64_t count = 0;
+    for (std::size_t b = 0; b < std::size(to.buckets); ++b) {
+      count += to.buckets[b] - from.buckets[b];
+    }
+    if (count == 0) {
+      return;
+    }
+    sample.average = static_cast<double>(to.latency_sum_us -
+                                         from.latency_sum_us) /
+                     static_cast<double>(count);
+    // the bucket which holds the 99th percentile
+    const auto rank = (count * 99 + 99) / 100;
+    std::uint64_t cumulative = 0;
+    for (std::size_t b = 0; b < std::size(to.buckets); ++b) {
+      cumulative += to.buckets[b] - from.buckets[b];
+      if (cumulative >= rank) {
+        sample.p99 = b < std::size(LiveMetrics::kBuckets)
+                         ? static_cast<double>(LiveMetrics::kBuckets[b])
+                         : std::numeric_limits<double>::infinity();
+        return;
+      }
+    }
+  }
+};
+
+}  // namespace tb
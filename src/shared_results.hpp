@@ -0,0 +1,324 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <statistics.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "live_metrics.hpp"
+
+namespace tb {
+
+// anonymous shared memory which forked worker processes write their results
+// into. it is sized for a fixed number of processes, threads per process,
+// transactions per thread and transaction types, and only the pages which
+// are written are backed by memory.
+class SharedResults {
+ public:
+  struct Layout {
+    std::size_t processes, threads, count, types, targets, phases;
+  };
+
+ private:
+  struct Header {
+    std::atomic<std::size_t> arrived;
+  };
+
+  struct ProcessSlot {
+    std::atomic<bool> arrived;
+    bool completed;
+    std::int64_t duration;
+    std::size_t connects, first_transactions, connection_errors;
+  };
+
+  struct ThreadSlot {
+    std::size_t success, error;
+    ClientUsage usage;
+  };
+
+  struct TypeSlot {
+    std::size_t commits, rollbacks, errors, savepoints, savepoint_rollbacks;
+    std::size_t latencies;
+  };
+
+  struct TargetSlot {
+    std::size_t errors, latencies;
+  };
+
+  struct PhaseSlot {
+    std::size_t errors, latencies;
+  };
+
+  // nanosecond arrays of a process, each threads * count long
+  enum Array : std::size_t {
+    kThreadLatencies,
+    kTypeLatencies,
+    kConnects,
+    kFirstTransactions,
+    kTargetLatencies,
+    kPhaseLatencies,
+    kArrays,
+  };
+
+ private:
+  Layout layout_;
+  std::size_t size_;
+  void* memory_;
+
+  Header* header_;
+  ProcessSlot* processes_;
+  ThreadSlot* threads_;
+  TypeSlot* types_;
+  TargetSlot* targets_;
+  PhaseSlot* phases_;
+  // of every type for every thread, updated while the processes run
+  LiveMetrics::TypeCounters* live_;
+  std::int64_t* values_;
+
+ public:
+  explicit SharedResults(const Layout& layout) : layout_(layout) {
+    const auto thread_slots = layout.processes * layout.threads;
+    const auto type_slots = layout.processes * layout.types;
+    const auto target_slots = layout.processes * layout.targets;
+    const auto phase_slots = layout.processes * layout.phases;
+    const auto live_slots = thread_slots * layout.types;
+    const auto values = layout.processes * kArrays * perProcess();
+    size_ = sizeof(Header) + sizeof(ProcessSlot) * layout.processes +
+            sizeof(ThreadSlot) * thread_slots + sizeof(TypeSlot) * type_slots +
+            sizeof(TargetSlot) * target_slots +
+            sizeof(PhaseSlot) * phase_slots +
+            sizeof(LiveMetrics::TypeCounters) * live_slots +
+            sizeof(std::int64_t) * values;
+
+    memory_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory_ == MAP_FAILED) {
+      throw std::runtime_error("cannot map shared memory for results");
+    }
+
+    auto address = static_cast<char*>(memory_);
+    header_ = new (address) Header{};
+    address += sizeof(Header);
+    processes_ = new (address) ProcessSlot[layout.processes]{};
+    address += sizeof(ProcessSlot) * layout.processes;
+    threads_ = new (address) ThreadSlot[thread_slots]{};
+    address += sizeof(ThreadSlot) * thread_slots;
+    types_ = new (address) TypeSlot[type_slots]{};
+    address += sizeof(TypeSlot) * type_slots;
+    targets_ = new (address) TargetSlot[target_slots]{};
+    address += sizeof(TargetSlot) * target_slots;
+    phases_ = new (address) PhaseSlot[phase_slots]{};
+    address += sizeof(PhaseSlot) * phase_slots;
+    live_ = new (address) LiveMetrics::TypeCounters[live_slots]{};
+    address += sizeof(LiveMetrics::TypeCounters) * live_slots;
+    values_ = reinterpret_cast<std::int64_t*>(address);
+  }
+
+  SharedResults(const SharedResults&) = delete;
+  SharedResults& operator=(const SharedResults&) = delete;
+
+  ~SharedResults() { munmap(memory_, size_); }
+
+ public:
+  // marks a process as being at the start barrier, or as gone when it
+  // exited without reaching it. only the first call per process counts.
+  void arrive(std::size_t process) {
+    if (!processes_[process].arrived.exchange(true)) {
+      header_->arrived.fetch_add(1);
+    }
+  }
+
+  // blocks until every process arrived
+  void wait() const {
+    while (header_->arrived.load() < layout_.processes) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+  // called by a worker process with the statistics of its threads
+  void store(std::size_t process, const Statistics& statistics) {
+    auto& slot = processes_[process];
+    slot.duration = statistics.duration().count();
+
+    for (std::size_t t = 0; t < statistics.threadCount(); ++t) {
+      auto& thread = threads_[process * layout_.threads + t];
+      const auto success =
+          statistics.concat<Statistics::kSuccessIndex>(static_cast<int>(t));
+      const auto error =
+          statistics.concat<Statistics::kErrorIndex>(static_cast<int>(t));
+      // successes from the front, errors from the back of the thread slice
+      auto latencies = array(process, kThreadLatencies) + t * layout_.count;
+      thread.success = Write(success, latencies);
+      thread.error = Write(error, latencies + layout_.count - std::size(error));
+      if (t < std::size(statistics.clientUsages())) {
+        thread.usage = statistics.clientUsages()[t];
+      }
+    }
+
+    // empty when no thread of the process could connect
+    const auto& types = statistics.transactionTypes();
+    auto type_latencies = array(process, kTypeLatencies);
+    for (std::size_t t = 0; t < std::size(types) && t < layout_.types; ++t) {
+      auto& type = types_[process * layout_.types + t];
+      type.commits = types[t].commits;
+      type.rollbacks = types[t].rollbacks;
+      type.errors = types[t].errors;
+      type.savepoints = types[t].savepoints;
+      type.savepoint_rollbacks = types[t].savepoint_rollbacks;
+      type.latencies = Write(types[t].latencies, type_latencies);
+      type_latencies += type.latencies;
+    }
+
+    const auto& targets = statistics.targets();
+    auto target_latencies = array(process, kTargetLatencies);
+    for (std::size_t t = 0; t < std::size(targets) && t < layout_.targets;
+         ++t) {
+      auto& target = targets_[process * layout_.targets + t];
+      target.errors = targets[t].errors;
+      target.latencies = Write(targets[t].latencies, target_latencies);
+      target_latencies += target.latencies;
+    }
+
+    const auto& phases = statistics.phases();
+    auto phase_latencies = array(process, kPhaseLatencies);
+    for (std::size_t p = 0; p < std::size(phases) && p < layout_.phases;
+         ++p) {
+      auto& phase = phases_[process * layout_.phases + p];
+      phase.errors = phases[p].errors;
+      phase.latencies = Write(phases[p].latencies, phase_latencies);
+      phase_latencies += phase.latencies;
+    }
+
+    const auto& connections = statistics.connections();
+    slot.connects = Write(connections.connect, array(process, kConnects));
+    slot.first_transactions = Write(connections.first_transaction,
+                                    array(process, kFirstTransactions));
+    slot.connection_errors = connections.errors;
+    slot.completed = true;
+  }
+
+  // live counters of the threads of every process, one after another
+  [[nodiscard]] LiveMetrics::TypeCounters* live() const noexcept {
+    return live_;
+  }
+
+  [[nodiscard]] bool completed(std::size_t process) const {
+    return processes_[process].completed;
+  }
+
+  // statistics of every thread of the processes which completed. types,
+  // targets and phases carry the names and settings of the run and are
+  // filled in here.
+  [[nodiscard]] Statistics merge(std::string name,
+                                 std::vector<TransactionTypeStatistics> types,
+                                 std::vector<TargetStatistics> targets,
+                                 std::vector<PhaseStatistics> phases) const {
+    std::vector<Statistics::ElapsedTImesPerThreadType> elapsed_times;
+    std::vector<ClientUsage> usages;
+    ConnectionTimes connections;
+    Statistics::ElapsedTimeType duration(0);
+
+    for (std::size_t p = 0; p < layout_.processes; ++p) {
+      const auto& slot = processes_[p];
+      if (!slot.completed) {
+        continue;
+      }
+      duration =
+          std::max(duration, Statistics::ElapsedTimeType(slot.duration));
+
+      for (std::size_t t = 0; t < layout_.threads; ++t) {
+        const auto& thread = threads_[p * layout_.threads + t];
+        const auto latencies = array(p, kThreadLatencies) + t * layout_.count;
+        elapsed_times.emplace_back(
+            Read(latencies, thread.success),
+            Read(latencies + layout_.count - thread.error, thread.error));
+        usages.emplace_back(thread.usage);
+      }
+
+      auto type_latencies = array(p, kTypeLatencies);
+      for (std::size_t t = 0; t < std::size(types); ++t) {
+        const auto& type = types_[p * layout_.types + t];
+        TransactionTypeStatistics stored;
+        stored.commits = type.commits;
+        stored.rollbacks = type.rollbacks;
+        stored.errors = type.errors;
+        stored.savepoints = type.savepoints;
+        stored.savepoint_rollbacks = type.savepoint_rollbacks;
+        stored.latencies = Read(type_latencies, type.latencies);
+        type_latencies += type.latencies;
+        types[t].merge(stored);
+      }
+
+      auto target_latencies = array(p, kTargetLatencies);
+      for (std::size_t t = 0; t < std::size(targets); ++t) {
+        const auto& target = targets_[p * layout_.targets + t];
+        TargetStatistics stored;
+        stored.errors = target.errors;
+        stored.latencies = Read(target_latencies, target.latencies);
+        target_latencies += target.latencies;
+        targets[t].merge(stored);
+      }
+
+      auto phase_latencies = array(p, kPhaseLatencies);
+      for (std::size_t q = 0; q < std::size(phases); ++q) {
+        const auto& phase = phases_[p * layout_.phases + q];
+        PhaseStatistics stored;
+        stored.errors = phase.errors;
+        stored.latencies = Read(phase_latencies, phase.latencies);
+        phase_latencies += phase.latencies;
+        phases[q].merge(stored);
+      }
+
+      const auto connects = Read(array(p, kConnects), slot.connects);
+      connections.connect.insert(std::end(connections.connect),
+                                 std::begin(connects), std::end(connects));
+      const auto firsts =
+          Read(array(p, kFirstTransactions), slot.first_transactions);
+      connections.first_transaction.insert(
+          std::end(connections.first_transaction), std::begin(firsts),
+          std::end(firsts));
+      connections.errors += slot.connection_errors;
+    }
+
+    const auto thread_count = std::size(elapsed_times);
+    Statistics statistics(std::move(name), thread_count,
+                          std::move(elapsed_times), duration);
+    statistics.clientUsages(std::move(usages));
+    statistics.connections(std::move(connections));
+    statistics.transactionTypes(std::move(types));
+    statistics.targets(std::move(targets));
+    statistics.phases(std::move(phases));
+    return statistics;
+  }
+
+ private:
+  [[nodiscard]] std::size_t perProcess() const {
+    return layout_.threads * layout_.count;
+  }
+
+  [[nodiscard]] std::int64_t* array(std::size_t process, Array which) const {
+    return values_ + (process * kArrays + which) * perProcess();
+  }
+
+  static std::size_t Write(const std::vector<std::chrono::nanoseconds>& from,
+                           std::int64_t* to) {
+    std::transform(std::begin(from), std::end(from), to,
+                   [](std::chrono::nanoseconds ns) { return ns.count(); });
+    return std::size(from);
+  }
+
+  static std::vector<std::chrono::nanoseconds> Read(const std::int64_t* from,
+                                                    std::size_t size) {
+    return std::vector<std::chrono::nanoseconds>(from, from + size);
+  }
+};
+
+}  // namespace tb
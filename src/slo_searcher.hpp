@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cmath>
+#include <configuration.hpp>
+#include <optional>
+#include <ostream>
+#include <properties.hpp>
+#include <statistics.hpp>
+#include <string>
+#include <vector>
+
+#include "executor.hpp"
+
+namespace tb {
+
+class SloSearchResult {
+ public:
+  struct Trial {
+    double rate, throughput, error_rate;
+    Statistics::ElapsedTimeType latency, latency_lower, latency_upper;
+    bool pass;
+  };
+
+ private:
+  std::string name_;
+  SloSetting setting_;
+  std::vector<Trial> trials_;
+
+ public:
+  SloSearchResult(std::string name, SloSetting setting,
+                  std::vector<Trial> trials)
+      : name_(std::move(name)),
+        setting_(setting),
+        trials_(std::move(trials)) {}
+
+ public:
+  [[nodiscard]] const std::vector<Trial>& trials() const noexcept {
+    return trials_;
+  }
+
+  // highest offered rate meeting the slo
+  [[nodiscard]] std::optional<double> maxRate() const {
+    std::optional<double> rate;
+    for (const auto& trial : trials_) {
+      if (trial.pass && (!rate || *rate < trial.rate)) {
+        rate = trial.rate;
+      }
+    }
+    return rate;
+  }
+
+  // lowest offered rate violating the slo above the max rate
+  [[nodiscard]] std::optional<double> upperBound() const {
+    const auto max_rate = maxRate().value_or(0.0);
+    std::optional<double> rate;
+    for (const auto& trial : trials_) {
+      if (!trial.pass && trial.rate > max_rate &&
+          (!rate || trial.rate < *rate)) {
+        rate = trial.rate;
+      }
+    }
+    return rate;
+  }
+
+  void dump(std::ostream& os) const {
+    const auto print_optional = [&os](const std::optional<double>& v) {
+      if (v) {
+        os << *v;
+      } else {
+        os << "~";
+      }
+      os << "\n";
+    };
+
+    os << std::dec;
+    os << "name: " << name_ << "\n"
+       << "mode: slo\n"
+       << "unit: ns\n"
+       << "slo:\n"
+       << "  percentile: " << setting_.percentile << "\n"
+       << "  latency: "
+       << std::chrono::duration_cast<Statistics::ElapsedTimeType>(
+              setting_.latency)
+              .count()
+       << "\n"
+       << "  max_error_rate: " << setting_.max_error_rate << "\n"
+       << "trials:\n";
+    for (const auto& trial : trials_) {
+      os << "  - {rate: " << trial.rate << ", throughput: " << trial.throughput
+         << ", error_rate: " << trial.error_rate
+         << ", latency: " << trial.latency.count()
+         << ", latency_lower: " << trial.latency_lower.count()
+         << ", latency_upper: " << trial.latency_upper.count()
+         << ", pass: " << (trial.pass ? "true" : "false") << "}\n";
+    }
+    os << "max_rate: ";
+    print_optional(maxRate());
+    os << "bounds:\n"
+       << "  lower: ";
+    print_optional(maxRate());
+    os << "  upper: ";
+    print_optional(upperBound());
+  }
+};
+
+class SloSearcher {
+ private:
+  // a window whose throughput falls behind the offered rate cannot sustain it
+  inline static constexpr double kMinAchievedRatio = 0.9;
+
+  Executor& executor_;
+
+ public:
+  explicit SloSearcher(Executor& executor) : executor_(executor) {}
+
+ public:
+  SloSearchResult search(Configuration config, const Properties& props) {
+    if (!config.slo()) {
+      throw std::runtime_error("slo setting is not provided");
+    }
+    // the offered rate is one for all workers
+    if (!std::empty(config.groups())) {
+      throw std::runtime_error(
+          "slo search is not supported for a workload with groups");
+    }
+    const auto setting = *config.slo();
+
+    std::vector<SloSearchResult::Trial> trials;
+    const auto measure = [&](double rate) {
+      const auto trial = run(config, props, setting, rate);
+      trials.emplace_back(trial);
+      std::cerr << "slo: rate=" << rate << " latency=" << trial.latency.count()
+                << " error_rate=" << trial.error_rate
+                << (trial.pass ? " pass" : " fail") << std::endl;
+      return trial.pass;
+    };
+
+    double lower = 0.0, upper = setting.max_rate;
+    if (!measure(setting.min_rate)) {
+      return SloSearchResult(config.name(), setting, std::move(trials));
+    }
+    lower = setting.min_rate;
+
+    if (upper <= 0) {
+      // probe upward until the slo is violated
+      for (auto rate = lower * 2;; rate *= 2) {
+        if (!measure(rate)) {
+          upper = rate;
+          break;
+        }
+        lower = rate;
+      }
+    } else if (measure(upper)) {
+      return SloSearchResult(config.name(), setting, std::move(trials));
+    }
+
+    while (upper - lower > setting.precision * lower) {
+      const auto rate = (lower + upper) / 2;
+      if (measure(rate)) {
+        lower = rate;
+      } else {
+        upper = rate;
+      }
+    }
+
+    return SloSearchResult(config.name(), setting, std::move(trials));
+  }
+
+ private:
+  SloSearchResult::Trial run(Configuration& config, const Properties& props,
+                             const SloSetting& setting, double rate) {
+    const auto workers =
+        static_cast<double>(config.threadCount() * config.processes());
+    const auto per_thread = std::ceil(
+        rate * static_cast<double>(setting.window.count()) / workers);
+    config.count(
+        std::max<std::size_t>(1, static_cast<std::size_t>(per_thread)));
+    config.rate(rate);
+
+    const auto stat = executor_.execute(config, props);
+
+    const auto success = stat.wholeCount<Statistics::kSuccessIndex>();
+    const auto error = stat.wholeCount<Statistics::kErrorIndex>();
+    const auto error_rate =
+        success + error == 0
+            ? 1.0
+            : static_cast<double>(error) / static_cast<double>(success + error);
+    const auto latency = stat.percentile(setting.percentile);
+    const auto [lower, upper] = stat.percentileInterval(setting.percentile);
+
+    const auto pass = latency <= setting.latency &&
+                      error_rate <= setting.max_error_rate &&
+                      stat.throughput() >= rate * kMinAchievedRatio;
+    return {rate, stat.throughput(), error_rate, latency, lower, upper, pass};
+  }
+};
+
+}  // namespace tb
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <configuration.hpp>
+#include <optional>
+#include <ostream>
+#include <properties.hpp>
+#include <statistics.hpp>
+#include <string>
+#include <vector>
+
+#include "executor.hpp"
+
+namespace tb {
+
+class SweepResult {
+ public:
+  struct Step {
+    std::size_t threads;
+    double throughput;
+    std::size_t success, error;
+    Statistics::ElapsedTimeType average, median, p99;
+  };
+
+ private:
+  std::string name_;
+  std::vector<Step> steps_;
+  bool stopped_early_;
+
+ public:
+  SweepResult(std::string name, std::vector<Step> steps, bool stopped_early)
+      : name_(std::move(name)),
+        steps_(std::move(steps)),
+        stopped_early_(stopped_early) {}
+
+ public:
+  [[nodiscard]] const std::vector<Step>& steps() const noexcept {
+    return steps_;
+  }
+
+  // first step where p99 grows relatively faster than throughput
+  [[nodiscard]] std::optional<std::size_t> knee() const {
+    for (std::size_t i = 1; i < std::size(steps_); ++i) {
+      const auto& prev = steps_[i - 1];
+      const auto& cur = steps_[i];
+      if (prev.throughput <= 0 || prev.p99.count() <= 0) {
+        continue;
+      }
+      const auto throughput_gain = cur.throughput / prev.throughput - 1.0;
+      const auto p99_gain = static_cast<double>(cur.p99.count()) /
+                                static_cast<double>(prev.p99.count()) -
+                            1.0;
+      if (p99_gain > throughput_gain) {
+        return cur.threads;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // thread count with the highest throughput
+  [[nodiscard]] std::optional<std::size_t> saturation() const {
+    if (std::empty(steps_)) {
+      return std::nullopt;
+    }
+    return std::max_element(std::begin(steps_), std::end(steps_),
+                            [](const Step& l, const Step& r) {
+                              return l.throughput < r.throughput;
+                            })
+        ->threads;
+  }
+
+  void dump(std::ostream& os) const {
+    const auto print_optional = [&os](const std::optional<std::size_t>& v) {
+      if (v) {
+        os << *v;
+      } else {
+        os << "~";
+      }
+      os << "\n";
+    };
+
+    os << std::dec;
+    os << "name: " << name_ << "\n"
+       << "mode: sweep\n"
+       << "unit: ns\n"
+       << "steps:\n";
+    for (const auto& step : steps_) {
+      os << "  - {threads: " << step.threads
+         << ", throughput: " << step.throughput
+         << ", success: " << step.success << ", error: " << step.error
+         << ", average: " << step.average.count()
+         << ", median: " << step.median.count()
+         << ", p99: " << step.p99.count() << "}\n";
+    }
+    os << "knee: ";
+    print_optional(knee());
+    os << "saturation: ";
+    print_optional(saturation());
+    os << "stopped_early: " << (stopped_early_ ? "true" : "false") << "\n";
+  }
+};
+
+class Sweeper {
+ private:
+  Executor& executor_;
+
+ public:
+  explicit Sweeper(Executor& executor) : executor_(executor) {}
+
+ public:
+  SweepResult sweep(Configuration config, const Properties& props) {
+    if (!config.sweep()) {
+      throw std::runtime_error("sweep setting is not provided");
+    }
+    const auto setting = *config.sweep();
+
+    std::vector<SweepResult::Step> steps;
+    double peak = 0.0;
+    bool stopped_early = false;
+
+    for (auto threads = setting.min_threads; threads <= setting.max_threads;
+         threads = setting.next(threads)) {
+      config.threadCount(threads);
+      const auto stat = executor_.execute(config, props);
+
+      steps.push_back({threads, stat.throughput(),
+                       stat.wholeCount<Statistics::kSuccessIndex>(),
+                       stat.wholeCount<Statistics::kErrorIndex>(),
+                       stat.average(), stat.median(), stat.percentile(99)});
+      std::cerr << "sweep: threads=" << threads
+                << " throughput=" << stat.throughput() << std::endl;
+
+      peak = std::max(peak, stat.throughput());
+      if (stat.throughput() < peak * (1.0 - setting.drop_tolerance)) {
+        stopped_early = true;
+        break;
+      }
+    }
+
+    return SweepResult(config.name(), std::move(steps), stopped_early);
+  }
+};
+
+}  // namespace tb
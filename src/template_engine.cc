@@ -4,13 +4,22 @@
 
 #include "template_engine.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/spirit/include/phoenix.hpp>
 #include <boost/spirit/include/qi.hpp>
+#include <charconv>
+#include <cmath>
+#include <map>
+#include <mutex>
 #include <random>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
+#include "data_file.hpp"
+
 namespace {
 
 template <class Iterator>
@@ -26,6 +35,11 @@ struct TemplateEngine
   boost::spirit::qi::rule<Iterator, tb::te::Statement()> statement;
 
   Rule<tb::te::Function()> function;
+  Rule<tb::te::Variable()> variable;
+  Rule<tb::te::Binding()> binding;
+  Rule<tb::te::Repeat()> repeat;
+  Rule<tb::te::End()> end_block;
+  Rule<tb::te::Term()> term;
   Rule<tb::te::Expression()> expression;
   // Rule<tb::te::Statement()> statement;
   Rule<std::vector<tb::te::Valuable>()> arguments;
@@ -42,10 +56,22 @@ struct TemplateEngine
 
     statement =
         +(expression[push_back(_val, _1)] | raw_string[push_back(_val, _1)]);
-    raw_string = (qi::print)[_val = _1];
-    expression = "{{" >> *space >> (function[_val = _1] |
-                                    identifier[_val = _1] | value[_val = _1]) >>
+    raw_string = +(qi::char_ - "{{");
+    expression = "{{" >> *space >>
+                 (binding[_val = _1] | repeat[_val = _1] |
+                  end_block[_val = _1] | function[_val = _1] |
+                  variable[_val = _1] | value[_val = _1]) >>
                  *space >> "}}";
+    binding = qi::lit("let") >> +space >>
+              identifier[bind(&Binding::name, _val) = _1] >> *space >> "=" >>
+              *space >> term[bind(&Binding::term, _val) = _1];
+    repeat = qi::lit("repeat") >> +space >>
+             term[bind(&Repeat::count, _val) = _1] >>
+             -(*space >> "," >> *space >>
+               string_value[bind(&Repeat::separator, _val) = _1]);
+    end_block = qi::lit("end") >> !(qi::alnum | qi::char_('_'));
+    term = function[_val = _1] | variable[_val = _1] | value[_val = _1];
+    variable = identifier[bind(&Variable::name, _val) = _1];
     function = identifier[bind(&Function::name, _val) = _1] >> *space >> "(" >>
                *space >> -arguments[bind(&Function::args, _val) = _1] >>
                *space >> ")";
@@ -53,71 +79,71 @@ struct TemplateEngine
                   *("," >> *space >> valuable[push_back(_val, _1)]) >> *space);
     identifier = qi::alpha[push_back(_val, _1)] >>
                  *((qi::alnum | qi::char_('_'))[push_back(_val, _1)]);
-    value = qi::long_long[_val = _1] | string_value[_val = _1];
+    value = qi::real_parser<double, qi::strict_real_policies<double>>()
+                [_val = _1] |
+            qi::int_parser<std::int_fast64_t>()[_val = _1] |
+            string_value[_val = _1];
     string_value =
-        qi::char_('"') >> *qi::print[push_back(_val, _1)] >> qi::char_('"');
-    valuable = value[_val = _1] | identifier[_val = _1];
-  }
-};
-
-struct ValueVisitor {
-  std::string operator()(const std::string& str) { return str; }
-  std::string operator()(std::int_fast64_t num) { return std::to_string(num); }
-};
-
-struct ExpressionVisitor {
-  ValueVisitor value_visitor;
-  tb::te::FunctionContainer container;
-
-  std::string operator()(const tb::te::Function& func) {
-    return this->operator()(container[func.name](func.args));
-  }
-
-  std::string operator()(const tb::te::Value& val) {
-    return std::visit(value_visitor, val);
+        qi::lit('"') >> *(qi::print - '"')[push_back(_val, _1)] >> '"';
+    valuable = value[_val = _1] | variable[_val = _1];
   }
 };
 
-struct StatementFragmentVisitor {
-  ExpressionVisitor expression_visitor;
-
-  std::string operator()(const tb::te::RawString& raw_string) {
-    return std::string() + raw_string;
-  }
-
-  std::string operator()(const tb::te::Expression& exp) {
-    return std::visit(expression_visitor, exp);
+void AppendValue(const tb::te::Value& value, std::string& out) {
+  switch (value.index()) {
+    case tb::te::kNumberIndex: {
+      char buffer[24];
+      const auto [last, ec] = std::to_chars(
+          buffer, buffer + sizeof(buffer),
+          std::get<tb::te::kNumberIndex>(value));
+      out.append(buffer, last);
+      break;
+    }
+    case tb::te::kStringIndex:
+      out += std::get<tb::te::kStringIndex>(value);
+      break;
+    case tb::te::kViewIndex:
+      out += std::get<tb::te::kViewIndex>(value);
+      break;
+    case tb::te::kRealIndex: {
+      char buffer[32];
+      const auto [last, ec] =
+          std::to_chars(buffer, buffer + sizeof(buffer),
+                        std::get<tb::te::kRealIndex>(value));
+      out.append(buffer, last);
+      break;
+    }
   }
-};
+}
 
 namespace functions {
 
 tb::te::Value random_string(const std::vector<tb::te::Value>& args) {
   static constexpr std::string_view kChars =
       "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-  static std::mt19937_64 mt(std::random_device{}());
-  static std::uniform_int_distribution<std::int_fast64_t> rand(
-      0, std::size(kChars) - 1);
+  thread_local std::string str;
 
-  auto length = std::get<tb::te::kNumberIndex>(args[0]);
-  std::string str(length, 0);
+  auto& mt = tb::te::CurrentWorker().random;
+  std::uniform_int_distribution<std::size_t> rand(0, std::size(kChars) - 1);
+  auto length = tb::te::AsNumber(args[0]);
+  str.resize(length);
   std::generate(std::begin(str), std::end(str),
-                [] { return kChars[rand(mt)]; });
-  return str;
+                [&] { return kChars[rand(mt)]; });
+  return std::string_view(str);
 }
 
 tb::te::Value random_number(const std::vector<tb::te::Value>& args) {
-  static std::mt19937_64 mt(std::random_device{}());
+  auto& mt = tb::te::CurrentWorker().random;
 
   std::int_fast64_t min = std::numeric_limits<std::int_fast64_t>::min(),
                     max = std::numeric_limits<std::int_fast64_t>::max();
   switch (std::size(args)) {
     case 1:
-      max = std::get<tb::te::kNumberIndex>(args[0]);
+      max = tb::te::AsNumber(args[0]);
       break;
     case 2:
-      min = std::get<tb::te::kNumberIndex>(args[0]);
-      max = std::get<tb::te::kNumberIndex>(args[1]);
+      min = tb::te::AsNumber(args[0]);
+      max = tb::te::AsNumber(args[1]);
       break;
   }
   std::uniform_int_distribution<std::int_fast64_t> rand(min, max);
@@ -125,43 +151,692 @@ tb::te::Value random_number(const std::vector<tb::te::Value>& args) {
   return rand(mt);
 }
 
+// zipf(min, max[, theta]): rank 0 (= min) is the most frequent value,
+// 0 < theta < 1 (default 0.99).
+// generator by Gray et al., "Quickly Generating Billion-Record Synthetic
+// Databases", as used by YCSB.
+class Zipfian {
+ private:
+  std::int_fast64_t items_;
+  double theta_, alpha_, zetan_, eta_;
+
+ public:
+  Zipfian(std::int_fast64_t items, double theta)
+      : items_(items), theta_(theta), alpha_(1.0 / (1.0 - theta)) {
+    zetan_ = Zeta(items_, theta_);
+    const auto zeta2 = Zeta(2, theta_);
+    eta_ = (1 - std::pow(2.0 / static_cast<double>(items_), 1 - theta_)) /
+           (1 - zeta2 / zetan_);
+  }
+
+  template <class Rng>
+  std::int_fast64_t operator()(Rng& rng) const {
+    const auto u = std::uniform_real_distribution<double>(0, 1)(rng);
+    const auto uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, theta_)) {
+      return std::min<std::int_fast64_t>(1, items_ - 1);
+    }
+    const auto rank = static_cast<std::int_fast64_t>(
+        static_cast<double>(items_) * std::pow(eta_ * u - eta_ + 1, alpha_));
+    return std::min(rank, items_ - 1);
+  }
+
+ private:
+  static double Zeta(std::int_fast64_t n, double theta) {
+    double sum = 0;
+    for (std::int_fast64_t i = 1; i <= n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+};
+
+tb::te::Value zipf(const std::vector<tb::te::Value>& args) {
+  auto& mt = tb::te::CurrentWorker().random;
+  // zeta is O(n), generators are built once per parameter set
+  static std::mutex mutex;
+  static std::map<std::tuple<std::int_fast64_t, double>,
+                  std::unique_ptr<Zipfian>>
+      generators;
+  thread_local std::map<std::tuple<std::int_fast64_t, double>,
+                        const Zipfian*>
+      cache;
+
+  const auto min = tb::te::AsNumber(args.at(0));
+  const auto max = tb::te::AsNumber(args.at(1));
+  const auto theta = std::size(args) > 2 ? tb::te::AsReal(args[2]) : 0.99;
+  if (max < min) {
+    throw std::runtime_error("invalid zipf parameter");
+  }
+  // the generator is only defined for theta below 1
+  if (theta <= 0 || theta >= 1) {
+    throw std::runtime_error("zipf theta must be between 0 and 1 exclusive");
+  }
+
+  const auto key = std::make_tuple(max - min + 1, theta);
+  auto& generator = cache[key];
+  if (!generator) {
+    std::lock_guard lg(mutex);
+    auto& shared = generators[key];
+    if (!shared) {
+      shared = std::make_unique<Zipfian>(max - min + 1, theta);
+    }
+    generator = shared.get();
+  }
+  return min + (*generator)(mt);
+}
+
+// buffer which payload() takes slices of. every chunk of it starts with
+// random characters and ends with a run of one character, the share of the
+// run is the compressibility. the characters need no escaping in SQL.
+class PayloadPool {
+ public:
+  inline static constexpr std::size_t kChunk = 128;
+  inline static constexpr std::size_t kMinSize = std::size_t(16) << 20;
+
+ private:
+  std::string data_;
+
+ public:
+  // the same seed for every pool, runs send the same payloads
+  PayloadPool(std::size_t size, double compressibility) : data_(size, 'a') {
+    static constexpr std::string_view kChars =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+    static_assert(std::size(kChars) == 64);
+
+    std::mt19937_64 random(0x7061796c6f6164);
+    // ten characters of six bits from every draw
+    std::uint64_t bits = 0;
+    int left = 0;
+    const auto next = [&] {
+      if (left == 0) {
+        bits = random();
+        left = 10;
+      }
+      const auto c = kChars[bits & 63];
+      bits >>= 6;
+      --left;
+      return c;
+    };
+
+    const auto literal = static_cast<std::size_t>(
+        std::lround((1.0 - compressibility) * static_cast<double>(kChunk)));
+    for (std::size_t chunk = 0; chunk < size; chunk += kChunk) {
+      const auto begin = std::begin(data_) + chunk;
+      const auto end = std::begin(data_) + std::min(size, chunk + kChunk);
+      const auto run = std::min(end, begin + literal);
+      std::generate(begin, run, next);
+      std::fill(run, end, next());
+    }
+  }
+
+  // room for slices of up to max bytes at many offsets
+  static std::size_t SizeFor(std::size_t max) {
+    auto size = kMinSize;
+    while (size < max * 2) {
+      size *= 2;
+    }
+    return size;
+  }
+
+  template <class Rng>
+  std::string_view slice(std::size_t length, Rng& rng) const {
+    std::uniform_int_distribution<std::size_t> offset(
+        0, std::size(data_) - length);
+    return std::string_view(data_).substr(offset(rng), length);
+  }
+};
+
+// length of payload(), the distribution is resolved once per parameter set
+class PayloadLength {
+ private:
+  enum class Distribution { kUniform, kLogUniform, kNormal };
+
+  std::int_fast64_t min_, max_;
+  Distribution distribution_;
+  std::uniform_int_distribution<std::int_fast64_t> uniform_;
+  std::uniform_real_distribution<double> log_uniform_;
+  std::normal_distribution<double> normal_;
+
+ public:
+  PayloadLength(std::int_fast64_t min, std::int_fast64_t max,
+                std::string_view distribution)
+      : min_(min),
+        max_(max),
+        distribution_(Parse(distribution)),
+        uniform_(min, max),
+        // as many payloads of 4-8 KB as of 512 KB-1 MB
+        log_uniform_(
+            std::log(static_cast<double>(std::max<std::int_fast64_t>(min, 1))),
+            std::log(static_cast<double>(max) + 1.0)),
+        normal_(static_cast<double>(min + max) / 2.0,
+                static_cast<double>(std::max<std::int_fast64_t>(max - min,
+                                                                1)) /
+                    6.0) {}
+
+  std::size_t operator()(std::mt19937_64& mt) {
+    if (min_ == max_) {
+      return static_cast<std::size_t>(min_);
+    }
+    double length;
+    switch (distribution_) {
+      case Distribution::kUniform:
+        return static_cast<std::size_t>(uniform_(mt));
+      case Distribution::kLogUniform:
+        length = std::exp(log_uniform_(mt));
+        break;
+      default:
+        length = normal_(mt);
+        break;
+    }
+    return static_cast<std::size_t>(
+        std::clamp(std::llround(length), static_cast<long long>(min_),
+                   static_cast<long long>(max_)));
+  }
+
+ private:
+  static Distribution Parse(std::string_view distribution) {
+    if (distribution == "uniform") {
+      return Distribution::kUniform;
+    } else if (distribution == "log_uniform") {
+      return Distribution::kLogUniform;
+    } else if (distribution == "normal") {
+      return Distribution::kNormal;
+    }
+    throw std::runtime_error("unknown payload distribution " +
+                             std::string(distribution));
+  }
+};
+
+// payload(min[, max[, compressibility[, distribution]]]): min to max bytes
+// from a pre-filled buffer without copying or drawing every character.
+// compressibility from 0 to 1 is the share of each 128 bytes which is one
+// repeated character. the others carry six bits each, so even 0 compresses
+// to about 3/4 with an entropy coder. distribution of the length is uniform
+// (default), log_uniform or normal. the buffers are never freed, each takes
+// at least 16 MB.
+tb::te::Value payload(const std::vector<tb::te::Value>& args) {
+  auto& mt = tb::te::CurrentWorker().random;
+  static std::mutex mutex;
+  static std::map<std::tuple<long, std::size_t>, std::unique_ptr<PayloadPool>>
+      pools;
+  // pool and length of each parameter set
+  struct Generator {
+    const PayloadPool* pool;
+    PayloadLength length;
+  };
+  thread_local std::map<std::tuple<std::int_fast64_t, std::int_fast64_t,
+                                   long, std::string>,
+                        Generator>
+      cache;
+
+  const auto min = tb::te::AsNumber(args.at(0));
+  const auto max = std::size(args) > 1 ? tb::te::AsNumber(args[1]) : min;
+  const auto compressibility =
+      std::size(args) > 2 ? tb::te::AsReal(args[2]) : 0.0;
+  const auto distribution =
+      std::size(args) > 3 ? tb::te::AsString(args[3]) : "uniform";
+  if (min < 0 || max < min || compressibility < 0 || compressibility > 1) {
+    throw std::runtime_error("invalid payload parameter");
+  }
+
+  // pools are shared by compressibilities which differ by less than 0.1%
+  const auto permille = std::lround(compressibility * 1000);
+  auto key = std::make_tuple(min, max, permille, std::string(distribution));
+  auto generator = cache.find(key);
+  if (generator == std::end(cache)) {
+    PayloadLength length(min, max, distribution);
+    const auto pool_key = std::make_tuple(
+        permille, PayloadPool::SizeFor(static_cast<std::size_t>(max)));
+    std::lock_guard lg(mutex);
+    auto& shared = pools[pool_key];
+    if (!shared) {
+      shared = std::make_unique<PayloadPool>(
+          std::get<1>(pool_key), static_cast<double>(permille) / 1000.0);
+    }
+    generator =
+        cache.emplace(std::move(key), Generator{shared.get(), length}).first;
+  }
+  auto& [pool, length] = generator->second;
+  return pool->slice(length(mt), mt);
+}
+
+// [begin, end) of this worker when [min, max) is divided by thread count
+template <class T>
+std::tuple<T, T> PartitionOf(T min, T max) {
+  const auto& worker = tb::te::CurrentWorker();
+  const auto range = max - min;
+  const auto id = static_cast<T>(worker.thread_id);
+  const auto count = static_cast<T>(worker.thread_count);
+  // range * id overflows for wide ranges, the first range % count parts
+  // take one more value instead
+  const auto offset = [range, count](T part) {
+    return range / count * part + std::min(part, range % count);
+  };
+  return {min + offset(id), min + offset(id + 1)};
+}
+
+tb::te::Value thread_id(const std::vector<tb::te::Value>&) {
+  return static_cast<std::int_fast64_t>(tb::te::CurrentWorker().thread_id);
+}
+
+tb::te::Value thread_count(const std::vector<tb::te::Value>&) {
+  return static_cast<std::int_fast64_t>(tb::te::CurrentWorker().thread_count);
+}
+
+// 1 for the first transaction of each worker
+tb::te::Value transaction_index(const std::vector<tb::te::Value>&) {
+  return static_cast<std::int_fast64_t>(
+      tb::te::CurrentWorker().transaction_index);
+}
+
+// optional name and start value of a sequence: ([name][, start])
+std::tuple<std::string_view, std::int_fast64_t> SequenceOf(
+    const std::vector<tb::te::Value>& args) {
+  std::string_view name;
+  std::int_fast64_t start = 1;
+  for (const auto& arg : args) {
+    if (arg.index() == tb::te::kStringIndex ||
+        arg.index() == tb::te::kViewIndex) {
+      name = tb::te::AsString(arg);
+    } else {
+      start = tb::te::AsNumber(arg);
+    }
+  }
+  return {name, start};
+}
+
+// sequence([name][, start]): shared by all threads, lock free after the
+// first call of each thread
+tb::te::Value sequence(const std::vector<tb::te::Value>& args) {
+  using Counter = std::atomic<std::int_fast64_t>;
+  static std::mutex mutex;
+  static std::map<std::string, std::unique_ptr<Counter>, std::less<>>
+      counters;
+  thread_local std::map<std::string, Counter*, std::less<>> cache;
+
+  const auto [name, start] = SequenceOf(args);
+  auto itr = cache.find(name);
+  if (itr == std::end(cache)) {
+    std::lock_guard lg(mutex);
+    auto& counter = counters[std::string(name)];
+    if (!counter) {
+      counter = std::make_unique<Counter>(0);
+    }
+    itr = cache.emplace(std::string(name), counter.get()).first;
+  }
+  return start + itr->second->fetch_add(1, std::memory_order_relaxed);
+}
+
+tb::te::Value thread_sequence(const std::vector<tb::te::Value>& args) {
+  auto& sequences = tb::te::CurrentWorker().sequences;
+  const auto [name, start] = SequenceOf(args);
+  auto itr = sequences.find(name);
+  if (itr == std::end(sequences)) {
+    itr = sequences.emplace(std::string(name), 0).first;
+  }
+  return start + itr->second++;
+}
+
+// interleaved_sequence([start]): unique over threads, thread i produces
+// start + i, start + i + thread_count, ...
+tb::te::Value interleaved_sequence(const std::vector<tb::te::Value>& args) {
+  auto& worker = tb::te::CurrentWorker();
+  const auto start = std::empty(args) ? 1 : tb::te::AsNumber(args[0]);
+  auto& n = worker.interleaved_sequence;
+  const auto value =
+      start + static_cast<std::int_fast64_t>(worker.thread_id) +
+      n * static_cast<std::int_fast64_t>(worker.thread_count);
+  ++n;
+  return value;
+}
+
+// partitioned_sequence(min, max): increasing values in this worker's part
+// of [min, max], wraps around at the end of the part
+tb::te::Value partitioned_sequence(const std::vector<tb::te::Value>& args) {
+  const auto min = tb::te::AsNumber(args.at(0));
+  const auto max = tb::te::AsNumber(args.at(1));
+  const auto [begin, end] = PartitionOf(min, max + 1);
+  if (begin == end) {
+    throw std::runtime_error("partition is empty");
+  }
+  auto& n = tb::te::CurrentWorker().partitioned_sequences[{min, max}];
+  return begin + n++ % (end - begin);
+}
+
+// partition(min, max): uniform random value in this worker's part of
+// [min, max]
+tb::te::Value partition(const std::vector<tb::te::Value>& args) {
+  const auto min = tb::te::AsNumber(args.at(0));
+  const auto max = tb::te::AsNumber(args.at(1));
+  const auto [begin, end] = PartitionOf(min, max + 1);
+  if (begin == end) {
+    throw std::runtime_error("partition is empty");
+  }
+  std::uniform_int_distribution<std::int_fast64_t> rand(begin, end - 1);
+  return rand(tb::te::CurrentWorker().random);
+}
+
+// file_*(name[, column]) draw a column of a loaded data file
+const tb::DataFile& DataFileOf(const std::vector<tb::te::Value>& args) {
+  return tb::DataFile::Get(std::string(tb::te::AsString(args.at(0))));
+}
+
+std::size_t ColumnOf(const std::vector<tb::te::Value>& args) {
+  if (std::size(args) < 2) {
+    return 0;
+  }
+  return tb::te::AsNumber(args[1]);
+}
+
+tb::te::Value file_random(const std::vector<tb::te::Value>& args) {
+  const auto& file = DataFileOf(args);
+  std::uniform_int_distribution<std::size_t> rand(0, file.lines() - 1);
+  return file.column(rand(tb::te::CurrentWorker().random), ColumnOf(args));
+}
+
+tb::te::Value file_sequential(const std::vector<tb::te::Value>& args) {
+  const auto& file = DataFileOf(args);
+  return file.column(file.next(), ColumnOf(args));
+}
+
+// each thread walks its own contiguous part of the file
+tb::te::Value file_partitioned(const std::vector<tb::te::Value>& args) {
+  thread_local std::unordered_map<const tb::DataFile*, std::size_t> cursors;
+
+  const auto& file = DataFileOf(args);
+  const auto [begin, end] = PartitionOf<std::size_t>(0, file.lines());
+  if (begin == end) {
+    throw std::runtime_error("data file has fewer lines than threads");
+  }
+
+  auto& cursor = cursors[&file];
+  const auto index = begin + cursor % (end - begin);
+  ++cursor;
+  return file.column(index, ColumnOf(args));
+}
+
 }  // namespace functions
 
 }  // namespace
 
 namespace tb {
 
-std::string CreateString(
+te::WorkerContext& te::CurrentWorker() {
+  thread_local WorkerContext context;
+  return context;
+}
+
+std::string_view te::AsString(const Value& value) {
+  switch (value.index()) {
+    case kStringIndex:
+      return std::get<kStringIndex>(value);
+    case kViewIndex:
+      return std::get<kViewIndex>(value);
+  }
+  throw std::runtime_error("template value is not a string");
+}
+
+std::int_fast64_t te::AsNumber(const Value& value) {
+  switch (value.index()) {
+    case kNumberIndex:
+      return std::get<kNumberIndex>(value);
+    case kRealIndex:
+      return static_cast<std::int_fast64_t>(std::get<kRealIndex>(value));
+  }
+  const auto str = AsString(value);
+  std::int_fast64_t number = 0;
+  const auto [last, ec] =
+      std::from_chars(str.data(), str.data() + std::size(str), number);
+  if (ec != std::errc() || last != str.data() + std::size(str)) {
+    throw std::runtime_error("template value is not a number");
+  }
+  return number;
+}
+
+double te::AsReal(const Value& value) {
+  if (value.index() == kRealIndex) {
+    return std::get<kRealIndex>(value);
+  }
+  if (value.index() == kNumberIndex) {
+    return static_cast<double>(std::get<kNumberIndex>(value));
+  }
+  // from_chars for floating point is not available everywhere
+  return std::stod(std::string(AsString(value)));
+}
+
+te::Template te::Template::Compile(
     const std::string& template_string,
-    const std::vector<
-        std::pair<std::string, tb::te::FunctionContainer::FunctionType>>&
+    const std::vector<std::pair<std::string, FunctionContainer::FunctionType>>&
+        functions) {
+  SymbolTable symbols;
+  return Compile(template_string, symbols, functions);
+}
+
+te::Template te::Template::Compile(
+    const std::string& template_string, SymbolTable& symbols,
+    const std::vector<std::pair<std::string, FunctionContainer::FunctionType>>&
         functions) {
   auto itr = std::begin(template_string);
   TemplateEngine<std::string::const_iterator> engine_parser;
 
-  tb::te::Statement stmt;
+  Template compiled;
+
+  Statement stmt;
   auto success = boost::spirit::qi::phrase_parse(
       itr, std::end(template_string), engine_parser, boost::spirit::qi::cntrl,
       stmt);
-  if (!success) {
-    return template_string;
+  if (std::empty(template_string)) {
+    compiled.fragments_.emplace_back(template_string);
+    return compiled;
+  }
+  // a malformed {{ }} stops the parser, the rest must not be dropped
+  if (!success || itr != std::end(template_string)) {
+    const auto offset = itr - std::begin(template_string);
+    throw std::runtime_error(
+        "malformed template at offset " + std::to_string(offset) + ": " +
+        std::string(itr, std::min(itr + 40, std::end(template_string))));
   }
 
-  tb::te::FunctionContainer function_container;
+  FunctionContainer function_container;
   function_container.addAll({
       {"random_string", functions::random_string},
+      {"payload", functions::payload},
       {"random_number", functions::random_number},
+      {"zipf", functions::zipf},
+      {"thread_id", functions::thread_id},
+      {"thread_count", functions::thread_count},
+      {"transaction_index", functions::transaction_index},
+      {"sequence", functions::sequence},
+      {"thread_sequence", functions::thread_sequence},
+      {"interleaved_sequence", functions::interleaved_sequence},
+      {"partitioned_sequence", functions::partitioned_sequence},
+      {"partition", functions::partition},
+      {"file_random", functions::file_random},
+      {"file_sequential", functions::file_sequential},
+      {"file_partitioned", functions::file_partitioned},
   });
   function_container.addAll(functions);
 
-  StatementFragmentVisitor stmt_visitor;
-  stmt_visitor.expression_visitor.container = function_container;
+  // an identifier which is not a bound variable is taken as a string
+  const auto resolve_function = [&](Function& function) {
+    if (!function_container.has(function.name)) {
+      throw std::runtime_error("unknown template function " + function.name);
+    }
+    Call call{function_container[function.name], {}, {}};
+    for (auto& arg : function.args) {
+      if (auto value = std::get_if<Value>(&arg)) {
+        call.args.emplace_back(std::move(*value));
+        continue;
+      }
+      const auto& name = std::get<Variable>(arg).name;
+      if (const auto slot = symbols.find(name)) {
+        call.variables.emplace_back(std::size(call.args), *slot);
+      }
+      call.args.emplace_back(name);
+    }
+    return call;
+  };
+  const auto resolve_term = [&](Term& term) -> Source {
+    if (auto function = std::get_if<Function>(&term)) {
+      return resolve_function(*function);
+    }
+    if (auto variable = std::get_if<Variable>(&term)) {
+      if (const auto slot = symbols.find(variable->name)) {
+        return VariableRef{*slot};
+      }
+      return Value(variable->name);
+    }
+    return std::move(std::get<Value>(term));
+  };
+
+  // fragment indices of repeat blocks which are not closed yet
+  std::vector<std::size_t> loops;
+  // literals are not merged across the boundary of a repeat block
+  std::size_t block_begin = 0;
+
+  for (auto& stmt_fragment : stmt) {
+    if (auto raw_string = std::get_if<RawString>(&stmt_fragment)) {
+      // adjacent literals are merged into one span
+      if (std::size(compiled.fragments_) > block_begin &&
+          std::holds_alternative<RawString>(compiled.fragments_.back())) {
+        std::get<RawString>(compiled.fragments_.back()) += *raw_string;
+      } else {
+        compiled.fragments_.emplace_back(std::move(*raw_string));
+      }
+      continue;
+    }
+
+    auto& expression = std::get<Expression>(stmt_fragment);
+    if (auto value = std::get_if<Value>(&expression)) {
+      compiled.fragments_.emplace_back(std::move(*value));
+    } else if (auto function = std::get_if<Function>(&expression)) {
+      compiled.fragments_.emplace_back(resolve_function(*function));
+    } else if (auto repeat = std::get_if<Repeat>(&expression)) {
+      loops.emplace_back(std::size(compiled.fragments_));
+      compiled.fragments_.emplace_back(Loop{resolve_term(repeat->count),
+                                            std::move(repeat->separator), 0});
+      block_begin = std::size(compiled.fragments_);
+    } else if (std::holds_alternative<End>(expression)) {
+      if (std::empty(loops)) {
+        throw std::runtime_error("end without repeat in template");
+      }
+      std::get<Loop>(compiled.fragments_[loops.back()]).length =
+          std::size(compiled.fragments_) - loops.back() - 1;
+      loops.pop_back();
+      block_begin = std::size(compiled.fragments_);
+    } else if (auto binding = std::get_if<Binding>(&expression)) {
+      // the term is resolved first so "let k = k" refers to the old k
+      auto source = resolve_term(binding->term);
+      compiled.fragments_.emplace_back(
+          Bind{symbols.define(binding->name), std::move(source)});
+    } else {
+      const auto& name = std::get<Variable>(expression).name;
+      if (const auto slot = symbols.find(name)) {
+        compiled.fragments_.emplace_back(VariableRef{*slot});
+      } else {
+        compiled.fragments_.emplace_back(RawString(name));
+      }
+    }
+  }
+  if (!std::empty(loops)) {
+    throw std::runtime_error("repeat without end in template");
+  }
+  compiled.slots_ = symbols.size();
+  return compiled;
+}
+
+te::Value te::Template::Invoke(const Call& call, Scope& scope) {
+  if (std::empty(call.variables)) {
+    return call.function(call.args);
+  }
+
+  // literal strings are passed as views to avoid copying them
+  auto& args = scope.arguments();
+  args.clear();
+  for (const auto& arg : call.args) {
+    if (arg.index() == kStringIndex) {
+      args.emplace_back(std::string_view(std::get<kStringIndex>(arg)));
+    } else {
+      args.emplace_back(arg);
+    }
+  }
+  for (const auto& [index, slot] : call.variables) {
+    args[index] = scope.get(slot);
+  }
+  return call.function(args);
+}
+
+te::Value te::Template::Evaluate(const Source& source, Scope& scope) {
+  switch (source.index()) {
+    case 0: {
+      const auto& value = std::get<Value>(source);
+      if (value.index() == kStringIndex) {
+        return std::string_view(std::get<kStringIndex>(value));
+      }
+      return value;
+    }
+    case 1:
+      return Invoke(std::get<Call>(source), scope);
+    default:
+      return scope.get(std::get<VariableRef>(source).slot);
+  }
+}
 
-  std::string result_string;
-  for (const auto& stmt_fragment : stmt) {
-    result_string += std::visit(stmt_visitor, stmt_fragment);
+void te::Template::render(std::string& out, Scope& scope) const {
+  Render(fragments_.data(), fragments_.data() + std::size(fragments_), out,
+         scope);
+}
+
+void te::Template::Render(const Fragment* first, const Fragment* last,
+                          std::string& out, Scope& scope) {
+  for (; first != last; ++first) {
+    const auto& fragment = *first;
+    switch (fragment.index()) {
+      case 0:
+        out += std::get<RawString>(fragment);
+        break;
+      case 1:
+        AppendValue(std::get<Value>(fragment), out);
+        break;
+      case 2:
+        AppendValue(Invoke(std::get<Call>(fragment), scope), out);
+        break;
+      case 3:
+        AppendValue(scope.get(std::get<VariableRef>(fragment).slot), out);
+        break;
+      case 4: {
+        const auto& bind = std::get<Bind>(fragment);
+        scope.set(bind.slot, Evaluate(bind.source, scope));
+        break;
+      }
+      case 5: {
+        // functions in the body are evaluated again for every repetition
+        const auto& loop = std::get<Loop>(fragment);
+        const auto count = AsNumber(Evaluate(loop.count, scope));
+        const auto body = first + 1;
+        for (std::int_fast64_t i = 0; i < count; ++i) {
+          if (i > 0) {
+            out += loop.separator;
+          }
+          Render(body, body + loop.length, out, scope);
+        }
+        first += loop.length;
+        break;
+      }
+    }
   }
-  return result_string;
+}
+
+std::string CreateString(
+    const std::string& template_string,
+    const std::vector<
+        std::pair<std::string, tb::te::FunctionContainer::FunctionType>>&
+        functions) {
+  return te::Template::Compile(template_string, functions).render();
 }
 
 }  // namespace tb
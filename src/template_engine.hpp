@@ -4,9 +4,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <functional>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace tb {
 
@@ -14,19 +21,49 @@ namespace te {
 
 using Id = std::string;
 
-inline constexpr std::size_t kNumberIndex = 0, kStringIndex = 1;
-using Value = std::variant<std::int_fast64_t, std::string>;
+// a view refers to storage owned by the function (or a data file) and is
+// valid until the next call of the function on the same thread
+inline constexpr std::size_t kNumberIndex = 0, kStringIndex = 1,
+                             kViewIndex = 2, kRealIndex = 3;
+using Value =
+    std::variant<std::int_fast64_t, std::string, std::string_view, double>;
 
-using Valuable = Value;
+// conversions accepting every alternative, for use in functions
+std::string_view AsString(const Value& value);
+std::int_fast64_t AsNumber(const Value& value);
+double AsReal(const Value& value);
+
+struct Variable {
+  Id name;
+};
+
+using Valuable = std::variant<Value, Variable>;
 
 struct Function {
   Id name;
   std::vector<Valuable> args;
 };
 
-using Expression = std::variant<Function, Value>;
+using Term = std::variant<Function, Variable, Value>;
 
-using RawString = char;
+// {{ let name = term }}
+struct Binding {
+  Id name;
+  Term term;
+};
+
+// {{ repeat count[, "separator"] }} ... {{ end }}
+struct Repeat {
+  Term count;
+  std::string separator;
+};
+
+struct End {};
+
+using Expression =
+    std::variant<Function, Value, Binding, Variable, Repeat, End>;
+
+using RawString = std::string;
 using Statement = std::vector<std::variant<RawString, Expression>>;
 
 class FunctionContainer {
@@ -58,6 +95,160 @@ class FunctionContainer {
   }
 };
 
+// variable slots shared by the templates of one transaction
+class SymbolTable {
+ private:
+  std::vector<Id> names_;
+
+ public:
+  std::size_t define(const Id& name) {
+    if (const auto slot = find(name)) {
+      return *slot;
+    }
+    names_.emplace_back(name);
+    return std::size(names_) - 1;
+  }
+
+  [[nodiscard]] std::optional<std::size_t> find(const Id& name) const {
+    const auto itr = std::find(std::begin(names_), std::end(names_), name);
+    if (itr == std::end(names_)) {
+      return std::nullopt;
+    }
+    return static_cast<std::size_t>(itr - std::begin(names_));
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return std::size(names_); }
+};
+
+// values bound while rendering one transaction. strings are copied into
+// storage owned by the scope so views from functions stay valid.
+class Scope {
+ private:
+  std::vector<std::string> storage_;
+  std::vector<Value> values_;
+  std::vector<Value> arguments_;
+
+ public:
+  void reset(std::size_t size) {
+    if (std::size(storage_) < size) {
+      storage_.resize(size);
+    }
+    values_.assign(size, Value(std::int_fast64_t(0)));
+  }
+
+  void set(std::size_t slot, const Value& value) {
+    if (value.index() == kNumberIndex || value.index() == kRealIndex) {
+      values_[slot] = value;
+      return;
+    }
+    storage_[slot].assign(AsString(value));
+    values_[slot] = std::string_view(storage_[slot]);
+  }
+
+  [[nodiscard]] const Value& get(std::size_t slot) const {
+    return values_[slot];
+  }
+
+  // scratch space for function arguments
+  std::vector<Value>& arguments() noexcept { return arguments_; }
+};
+
+// parsed template with functions and variables resolved, rendered without
+// allocation once the buffers have grown to their working size
+class Template {
+ private:
+  struct VariableRef {
+    std::size_t slot;
+  };
+  struct Call {
+    FunctionContainer::FunctionType function;
+    std::vector<Value> args;
+    // arguments replaced by variables: (argument index, slot)
+    std::vector<std::pair<std::size_t, std::size_t>> variables;
+  };
+  using Source = std::variant<Value, Call, VariableRef>;
+  struct Bind {
+    std::size_t slot;
+    Source source;
+  };
+  // the body is made of the next length fragments
+  struct Loop {
+    Source count;
+    std::string separator;
+    std::size_t length;
+  };
+  using Fragment =
+      std::variant<RawString, Value, Call, VariableRef, Bind, Loop>;
+
+ private:
+  std::vector<Fragment> fragments_;
+  std::size_t slots_ = 0;
+
+ public:
+  static Template Compile(
+      const std::string& template_string,
+      const std::vector<std::pair<std::string, FunctionContainer::FunctionType>>&
+          functions = {});
+
+  // variables are shared with other templates compiled with symbols
+  static Template Compile(
+      const std::string& template_string, SymbolTable& symbols,
+      const std::vector<std::pair<std::string, FunctionContainer::FunctionType>>&
+          functions = {});
+
+ public:
+  // appends the rendered string to out
+  void render(std::string& out, Scope& scope) const;
+
+  void render(std::string& out) const {
+    Scope scope;
+    scope.reset(slots_);
+    render(out, scope);
+  }
+
+  [[nodiscard]] std::string render() const {
+    std::string out;
+    render(out);
+    return out;
+  }
+
+ private:
+  static Value Evaluate(const Source& source, Scope& scope);
+  static void Render(const Fragment* first, const Fragment* last,
+                     std::string& out, Scope& scope);
+  static Value Invoke(const Call& call, Scope& scope);
+};
+
+// state of the worker thread which renders templates. generators live here
+// so that workers do not share anything while rendering.
+struct WorkerContext {
+  std::size_t thread_id = 0, thread_count = 1;
+  std::size_t transaction_index = 0;
+  std::mt19937_64 random{std::random_device{}()};
+  std::map<std::string, std::int_fast64_t, std::less<>> sequences;
+  std::map<std::pair<std::int_fast64_t, std::int_fast64_t>, std::int_fast64_t>
+      partitioned_sequences;
+  std::int_fast64_t interleaved_sequence = 0;
+
+  // called by the executor before the worker renders its first transaction.
+  // with a seed every worker draws the same values in every run.
+  void reset(std::size_t id, std::size_t count,
+             std::optional<std::uint64_t> seed = std::nullopt) {
+    if (seed) {
+      std::seed_seq sequence{*seed, static_cast<std::uint64_t>(id)};
+      random.seed(sequence);
+    }
+    thread_id = id;
+    thread_count = count;
+    transaction_index = 0;
+    sequences.clear();
+    partitioned_sequences.clear();
+    interleaved_sequence = 0;
+  }
+};
+
+WorkerContext& CurrentWorker();
+
 }  // namespace te
 
 std::string CreateString(
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <configuration.hpp>
+#include <database.hpp>
+#include <random>
+#include <statistics.hpp>
+#include <string_view>
+#include <vector>
+
+#include "clock.hpp"
+
+namespace tb {
+
+// slowest transactions and a uniform sample of the errors of one worker.
+// both are bounded and their entries are reused, so the strings keep their
+// capacity, and nothing is copied for a transaction faster than the fastest
+// one kept.
+class TransactionCapture {
+ private:
+  std::size_t slowest_capacity_ = 0, error_capacity_ = 0;
+  // min heap on latency, the fastest one kept in front
+  std::vector<CapturedTransaction> slowest_;
+  std::vector<CapturedTransaction> errors_;
+  std::size_t errors_seen_ = 0;
+  // for reservoir sampling, apart from the generators of the workload so
+  // capturing does not change what is rendered
+  std::minstd_rand random_;
+
+ public:
+  TransactionCapture() = default;
+
+  explicit TransactionCapture(const CaptureSetting& setting)
+      : slowest_capacity_(setting.slowest), error_capacity_(setting.errors) {
+    slowest_.reserve(slowest_capacity_);
+    errors_.reserve(error_capacity_);
+  }
+
+ public:
+  // whether a successful transaction this slow would be kept
+  [[nodiscard]] bool wants(std::chrono::nanoseconds latency) const noexcept {
+    if (std::size(slowest_) < slowest_capacity_) {
+      return true;
+    }
+    return slowest_capacity_ > 0 && latency > slowest_.front().latency;
+  }
+
+  // the last transaction of generator, which succeeded
+  void success(const TransactionGenerator& generator,
+               const std::vector<Clock::duration>& timings, std::size_t thread,
+               std::chrono::nanoseconds start,
+               std::chrono::nanoseconds latency) {
+    if (!wants(latency)) {
+      return;
+    }
+    if (std::size(slowest_) < slowest_capacity_) {
+      slowest_.emplace_back();
+    } else {
+      std::pop_heap(std::begin(slowest_), std::end(slowest_), Slower);
+    }
+    Fill(slowest_.back(), generator, timings, thread, start, latency);
+    std::push_heap(std::begin(slowest_), std::end(slowest_), Slower);
+  }
+
+  // the last transaction of generator, which failed with message
+  void error(const TransactionGenerator& generator,
+             const std::vector<Clock::duration>& timings, std::size_t thread,
+             std::chrono::nanoseconds start, std::chrono::nanoseconds latency,
+             std::string_view message) {
+    if (error_capacity_ == 0) {
+      return;
+    }
+    ++errors_seen_;
+    CapturedTransaction* entry = nullptr;
+    if (std::size(errors_) < error_capacity_) {
+      entry = &errors_.emplace_back();
+    } else {
+      const auto index = std::uniform_int_distribution<std::size_t>(
+          0, errors_seen_ - 1)(random_);
+      if (index >= error_capacity_) {
+        return;
+      }
+      entry = &errors_[index];
+    }
+    Fill(*entry, generator, timings, thread, start, latency);
+    entry->error.assign(message);
+  }
+
+ public:
+  // keeps the slowest of all workers, and samples the errors of each worker
+  // in proportion to how many errors it had
+  static void Merge(std::vector<TransactionCapture> captures,
+                    const CaptureSetting& setting, Statistics& statistics) {
+    std::vector<CapturedTransaction> slowest;
+    std::vector<std::pair<double, CapturedTransaction>> errors;
+    std::minstd_rand random;
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (auto& capture : captures) {
+      std::move(std::begin(capture.slowest_), std::end(capture.slowest_),
+                std::back_inserter(slowest));
+      if (std::empty(capture.errors_)) {
+        continue;
+      }
+      // weighted sampling by the largest u^(1/w)
+      const auto weight = static_cast<double>(capture.errors_seen_) /
+                          static_cast<double>(std::size(capture.errors_));
+      for (auto& entry : capture.errors_) {
+        errors.emplace_back(std::pow(uniform(random), 1.0 / weight),
+                            std::move(entry));
+      }
+    }
+
+    std::sort(std::begin(slowest), std::end(slowest), Slower);
+    slowest.resize(std::min(std::size(slowest), setting.slowest));
+
+    std::sort(std::begin(errors), std::end(errors),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+    errors.resize(std::min(std::size(errors), setting.errors));
+    std::vector<CapturedTransaction> sampled;
+    for (auto& [key, entry] : errors) {
+      sampled.emplace_back(std::move(entry));
+    }
+    std::sort(std::begin(sampled), std::end(sampled),
+              [](const auto& a, const auto& b) { return a.start < b.start; });
+
+    statistics.captured(std::move(slowest), std::move(sampled));
+  }
+
+ private:
+  // heap order with the fastest in front, sorted order slowest first
+  static bool Slower(const CapturedTransaction& a,
+                     const CapturedTransaction& b) {
+    return a.latency > b.latency;
+  }
+
+  static void Fill(CapturedTransaction& entry,
+                   const TransactionGenerator& generator,
+                   const std::vector<Clock::duration>& timings,
+                   std::size_t thread, std::chrono::nanoseconds start,
+                   std::chrono::nanoseconds latency) {
+    entry.type.assign(generator.setting().name);
+    entry.thread = thread;
+    entry.start = start;
+    entry.latency = latency;
+    entry.statements.resize(generator.size());
+    for (std::size_t i = 0; i < generator.size(); ++i) {
+      auto& statement = entry.statements[i];
+      statement.clear();
+      if (const auto operation = generator.operation(i)) {
+        database::AppendSql(statement, *operation);
+      } else {
+        statement.assign(generator.query(i));
+      }
+    }
+    entry.timings.assign(std::begin(timings), std::end(timings));
+    entry.error.clear();
+  }
+};
+
+}  // namespace tb